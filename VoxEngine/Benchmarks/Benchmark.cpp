@@ -0,0 +1,107 @@
+#include "Benchmark.h"
+
+#include "TerrainBenchmarks.h"
+#include "StorageBenchmarks.h"
+#include "FlythroughBenchmark.h"
+#include "ChunkBenchmarks.h"
+#include "CoreBenchmarks.h"
+#include "ThreadPool.h"
+
+#include <iostream>
+#include <iomanip>
+
+void Benchmark::printResult(const Result& result)
+{
+	double perSecond = result.seconds > 0.0 ? result.items / result.seconds : 0.0;
+	double perCore = result.threads > 0 ? perSecond / result.threads : perSecond;
+
+	std::cout << std::fixed << std::left
+		<< std::setw(45) << result.name
+		<< std::setprecision(1) << std::setw(14) << perSecond << result.unit << "/s"
+		<< "  " << std::setw(12) << perCore << result.unit << "/s per core"
+		<< "  (" << result.items << " in " << std::setprecision(3) << result.seconds << " s, "
+		<< result.threads << " threads)" << std::endl;
+}
+
+bool Benchmark::run(const std::string& name)
+{
+	bool all = name == "all";
+	bool micro = all || name == "micro"; // Hot path baselines
+	bool found = false;
+
+	ThreadPool pool;
+
+	if (all || name == "density")
+	{
+		TerrainBenchmarks::runDensityBenchmark(pool);
+		found = true;
+	}
+
+	if (all || name == "biome")
+	{
+		TerrainBenchmarks::runBiomeBenchmark(pool);
+		found = true;
+	}
+
+	if (all || name == "columncache")
+	{
+		TerrainBenchmarks::runColumnCacheBenchmark(pool);
+		found = true;
+	}
+
+	if (all || name == "region")
+	{
+		StorageBenchmarks::runRegionBenchmark();
+		found = true;
+	}
+
+	if (all || name == "delta")
+	{
+		StorageBenchmarks::runDeltaBenchmark();
+		found = true;
+	}
+
+	if (micro || name == "buildblocks")
+	{
+		ChunkBenchmarks::runBuildBlocksBenchmark(pool);
+		found = true;
+	}
+
+	if (micro || name == "mesh")
+	{
+		ChunkBenchmarks::runMeshBenchmark();
+		found = true;
+	}
+
+	if (micro || name == "neighbors")
+	{
+		ChunkBenchmarks::runNeighborLookupBenchmark();
+		found = true;
+	}
+
+	if (micro || name == "contention")
+	{
+		ChunkBenchmarks::runColumnContentionBenchmark(pool);
+		found = true;
+	}
+
+	if (micro || name == "hashmap")
+	{
+		CoreBenchmarks::runHashMapBenchmark();
+		found = true;
+	}
+
+	if (micro || name == "threadpool")
+	{
+		CoreBenchmarks::runThreadPoolBenchmark(pool);
+		found = true;
+	}
+
+	if (all || name == "flythrough")
+	{
+		FlythroughBenchmark::runAll(pool);
+		found = true;
+	}
+
+	return found;
+}
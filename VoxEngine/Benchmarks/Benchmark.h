@@ -0,0 +1,35 @@
+#pragma once
+#include <chrono>
+#include <string>
+#include <cstdint>
+
+// Minimal timing harness. Benchmarks run from the command line: VoxEngine --benchmark <name|all>
+class Benchmark
+{
+public:
+	struct Result
+	{
+		std::string name;
+		double seconds = 0.0;
+		uint64_t items = 0;       // Work units processed, e.g. chunks
+		const char* unit = "items";
+		size_t threads = 1;
+	};
+
+	template<typename Func>
+	static double measureSeconds(Func func);
+
+	static void printResult(const Result& result);
+
+	// Returns false if no benchmark with that name exists
+	static bool run(const std::string& name);
+};
+
+template<typename Func>
+inline double Benchmark::measureSeconds(Func func)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	func();
+	auto end = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration<double>(end - start).count();
+}
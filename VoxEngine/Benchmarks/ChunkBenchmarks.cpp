@@ -0,0 +1,359 @@
+#include "ChunkBenchmarks.h"
+
+#include "Benchmark.h"
+#include "../Chunk.h"
+#include "../TerrainGenerator.h"
+#include "../Graphics/ChunkMesh.h"
+#include "ThreadPool.h"
+
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <cstring>
+
+enum class ChunkFixture
+{
+	Flat,
+	Hilly,
+	Cave,
+	Checkerboard
+};
+
+constexpr ChunkFixture GENERATED_FIXTURES[] = { ChunkFixture::Flat, ChunkFixture::Hilly, ChunkFixture::Cave };
+constexpr ChunkFixture ALL_FIXTURES[] = { ChunkFixture::Flat, ChunkFixture::Hilly, ChunkFixture::Cave, ChunkFixture::Checkerboard };
+constexpr int FIXTURE_COLUMNS = 8; // buildBlocks covers 8x8 columns of the fixture's layers
+constexpr int FIXTURE_SEED = 1337;
+
+static const char* getFixtureName(ChunkFixture fixture)
+{
+	switch (fixture)
+	{
+	case ChunkFixture::Flat: return "flat";
+	case ChunkFixture::Hilly: return "hilly";
+	case ChunkFixture::Cave: return "cave";
+	case ChunkFixture::Checkerboard: return "checkerboard";
+	default: return "unknown";
+	}
+}
+
+// Chunk layers that hold the fixture's interesting blocks, the mesh fixtures use the middle one
+static void getFixtureLayers(ChunkFixture fixture, int& minY, int& maxY)
+{
+	switch (fixture)
+	{
+	case ChunkFixture::Flat: minY = -1; maxY = 0; break;
+	case ChunkFixture::Hilly: minY = -2; maxY = 2; break;
+	case ChunkFixture::Cave: minY = -5; maxY = -3; break;
+	default: minY = 0; maxY = 0; break;
+	}
+}
+
+static void configureGenerator(TerrainGenerator& generator, ChunkFixture fixture)
+{
+	switch (fixture)
+	{
+	case ChunkFixture::Flat:
+		generator.setHeightNoise(TerrainGenerator::createDefaultHeightNoise(), 0.004f, 0.0f, 0.0f);
+		generator.setDensityEnabled(false);
+		generator.setBiomesEnabled(false);
+		break;
+	case ChunkFixture::Hilly:
+		generator.setHeightNoise(TerrainGenerator::createDefaultHeightNoise(), 0.004f, 64.0f, 0.0f);
+		generator.setDensityEnabled(false);
+		break;
+	default:
+		break; // Default settings carve caves with 3D density
+	}
+}
+
+// 3x3x3 chunks linked the way World links them, so meshing the center reads real neighbours
+class ChunkNeighborhood
+{
+	std::unique_ptr<Chunk> chunks[27];
+public:
+	ChunkNeighborhood(TerrainGenerator& generator, ChunkFixture fixture, const Int3& center)
+	{
+		static Block pattern[CHUNK_VOLUME];
+		for (int x = 0; x < CHUNK_SIZE; x++)
+		{
+			for (int y = 0; y < CHUNK_SIZE; y++)
+			{
+				for (int z = 0; z < CHUNK_SIZE; z++)
+				{
+					pattern[getChunkBlockIndex(x, y, z)] = ((x + y + z) & 1) ? Block::Solid : Block::Air;
+				}
+			}
+		}
+
+		for (int i = 0; i < 27; i++)
+		{
+			int dx = i / 9 - 1, dy = i / 3 % 3 - 1, dz = i % 3 - 1;
+			Chunk* neighbors[6] =
+			{
+				dx > -1 ? chunks[i - 9].get() : nullptr, nullptr,
+				dy > -1 ? chunks[i - 3].get() : nullptr, nullptr,
+				dz > -1 ? chunks[i - 1].get() : nullptr, nullptr
+			};
+
+			chunks[i] = std::make_unique<Chunk>();
+			Chunk* chunk = chunks[i].get();
+			chunk->init(center.x + dx, center.y + dy, center.z + dz, neighbors);
+			if (fixture == ChunkFixture::Checkerboard)
+			{
+				chunk->setStoredBlocks(false, Block::Air, pattern);
+			}
+			else
+			{
+				chunk->buildBlocks(generator);
+			}
+			memset(chunk->getLightData(), 15, CHUNK_VOLUME);
+		}
+	}
+
+	~ChunkNeighborhood()
+	{
+		for (auto& chunk : chunks)
+		{
+			chunk->destroy();
+		}
+	}
+
+	ChunkNeighborhood(const ChunkNeighborhood&) = delete;
+	ChunkNeighborhood& operator=(const ChunkNeighborhood&) = delete;
+
+	const Chunk& getCenter() const { return *chunks[13]; }
+};
+
+static Int3 getFixtureCenter(ChunkFixture fixture)
+{
+	int minY, maxY;
+	getFixtureLayers(fixture, minY, maxY);
+	return Int3(FIXTURE_COLUMNS / 2, (minY + maxY) / 2, FIXTURE_COLUMNS / 2);
+}
+
+void ChunkBenchmarks::runBuildBlocksBenchmark(ThreadPool& pool)
+{
+	std::cout << "\n=== CHUNK BUILD BLOCKS BENCHMARK ===\n";
+
+	constexpr int REPEATS = 8;
+
+	for (ChunkFixture fixture : GENERATED_FIXTURES)
+	{
+		TerrainGenerator generator(FIXTURE_SEED);
+		configureGenerator(generator, fixture);
+
+		int minY, maxY;
+		getFixtureLayers(fixture, minY, maxY);
+
+		// Held for the whole run, so buildBlocks finds every column loaded
+		std::vector<const ChunkColumnData*> columns;
+		for (int x = 0; x < FIXTURE_COLUMNS; x++)
+		{
+			for (int z = 0; z < FIXTURE_COLUMNS; z++)
+			{
+				columns.push_back(generator.loadChunkColumnData(x, z));
+			}
+		}
+
+		auto buildRegion = [&generator, minY, maxY](int xBegin, int xEnd)
+			{
+				Chunk* noNeighbors[6] = { nullptr, nullptr, nullptr, nullptr, nullptr, nullptr };
+				Chunk chunk;
+				for (int x = xBegin; x < xEnd; x++)
+				{
+					for (int z = 0; z < FIXTURE_COLUMNS; z++)
+					{
+						for (int y = minY; y <= maxY; y++)
+						{
+							chunk.init(x, y, z, noNeighbors);
+							chunk.buildBlocks(generator);
+							chunk.destroy();
+						}
+					}
+				}
+			};
+
+		buildRegion(0, FIXTURE_COLUMNS); // Warm up
+
+		Benchmark::Result single;
+		single.name = std::string("buildBlocks, ") + getFixtureName(fixture) + ", single thread";
+		single.unit = "chunks";
+		single.items = static_cast<uint64_t>(REPEATS) * FIXTURE_COLUMNS * FIXTURE_COLUMNS * (maxY - minY + 1);
+		single.seconds = Benchmark::measureSeconds([&]()
+			{
+				for (int i = 0; i < REPEATS; i++)
+				{
+					buildRegion(0, FIXTURE_COLUMNS);
+				}
+			});
+		Benchmark::printResult(single);
+
+		// One task per column row and repeat
+		Benchmark::Result parallel = single;
+		parallel.name = std::string("buildBlocks, ") + getFixtureName(fixture) + ", thread pool";
+		parallel.threads = pool.getThreadCount();
+		parallel.seconds = Benchmark::measureSeconds([&]()
+			{
+				std::vector<std::future<void>> futures;
+				for (int i = 0; i < REPEATS; i++)
+				{
+					for (int x = 0; x < FIXTURE_COLUMNS; x++)
+					{
+						futures.push_back(pool.enqueue(buildRegion, x, x + 1));
+					}
+				}
+				for (auto& future : futures)
+				{
+					future.wait();
+				}
+			});
+		Benchmark::printResult(parallel);
+
+		for (const ChunkColumnData* column : columns)
+		{
+			generator.releaseChunkColumnData(column);
+		}
+	}
+}
+
+void ChunkBenchmarks::runMeshBenchmark()
+{
+	std::cout << "\n=== CHUNK MESH BENCHMARK ===\n";
+
+	constexpr int ITERATIONS = 2000;
+
+	for (ChunkFixture fixture : ALL_FIXTURES)
+	{
+		TerrainGenerator generator(FIXTURE_SEED);
+		configureGenerator(generator, fixture);
+		ChunkNeighborhood neighborhood(generator, fixture, getFixtureCenter(fixture));
+		const Chunk& chunk = neighborhood.getCenter();
+
+		std::vector<BlockFaceInstance> faces;
+		chunk.buildMeshData(faces); // Warm up, sizes the vector
+		const size_t faceCount = faces.size();
+
+		Benchmark::Result result;
+		result.name = std::string("buildMeshData, ") + getFixtureName(fixture) + ", " + std::to_string(faceCount) + " faces";
+		result.unit = "chunks";
+		result.items = ITERATIONS;
+		result.seconds = Benchmark::measureSeconds([&]()
+			{
+				for (int i = 0; i < ITERATIONS; i++)
+				{
+					faces.clear();
+					chunk.buildMeshData(faces);
+				}
+			});
+		Benchmark::printResult(result);
+	}
+}
+
+void ChunkBenchmarks::runNeighborLookupBenchmark()
+{
+	std::cout << "\n=== CHUNK NEIGHBOR LOOKUP BENCHMARK ===\n";
+
+	constexpr int ITERATIONS = 500;
+	constexpr int LOOKUPS_PER_ITERATION = (CHUNK_SIZE + 2) * (CHUNK_SIZE + 2) * (CHUNK_SIZE + 2);
+
+	for (ChunkFixture fixture : ALL_FIXTURES)
+	{
+		TerrainGenerator generator(FIXTURE_SEED);
+		configureGenerator(generator, fixture);
+		ChunkNeighborhood neighborhood(generator, fixture, getFixtureCenter(fixture));
+		const Chunk& chunk = neighborhood.getCenter();
+
+		// The sum keeps the lookups from being optimized away
+		volatile uint64_t sink = 0;
+		Benchmark::Result result;
+		result.name = std::string("getBlock_checkNeighbors, ") + getFixtureName(fixture);
+		result.unit = "lookups";
+		result.items = static_cast<uint64_t>(ITERATIONS) * LOOKUPS_PER_ITERATION;
+		result.seconds = Benchmark::measureSeconds([&]()
+			{
+				for (int i = 0; i < ITERATIONS; i++)
+				{
+					uint64_t sum = 0;
+					for (int x = -1; x <= CHUNK_SIZE; x++)
+					{
+						for (int y = -1; y <= CHUNK_SIZE; y++)
+						{
+							for (int z = -1; z <= CHUNK_SIZE; z++)
+							{
+								sum += static_cast<uint64_t>(chunk.getBlock_checkNeighbors(x, y, z));
+							}
+						}
+					}
+					sink = sink + sum;
+				}
+			});
+		Benchmark::printResult(result);
+	}
+}
+
+void ChunkBenchmarks::runColumnContentionBenchmark(ThreadPool& pool)
+{
+	std::cout << "\n=== COLUMN LOAD CONTENTION BENCHMARK ===\n";
+
+	constexpr int REGION_COLUMNS = 32;
+	constexpr int HOT_COLUMNS = 4;
+	constexpr int LOADS_PER_TASK = 1 << 18;
+
+	TerrainGenerator generator(FIXTURE_SEED);
+	std::vector<const ChunkColumnData*> columns;
+	for (int x = 0; x < REGION_COLUMNS; x++)
+	{
+		for (int z = 0; z < REGION_COLUMNS; z++)
+		{
+			columns.push_back(generator.loadChunkColumnData(x, z));
+		}
+	}
+
+	// Hot: every task cycles through the same few columns, spread: each task walks the region from its own offset
+	auto loadColumns = [&generator](int task, bool hot)
+		{
+			for (int i = 0; i < LOADS_PER_TASK; i++)
+			{
+				int index = hot ? i % HOT_COLUMNS : (task * 97 + i) % (REGION_COLUMNS * REGION_COLUMNS);
+				generator.releaseChunkColumnData(generator.loadChunkColumnData(index / REGION_COLUMNS, index % REGION_COLUMNS));
+			}
+		};
+
+	const bool modes[] = { true, false };
+	for (bool hot : modes)
+	{
+		const char* modeName = hot ? "hot columns" : "spread columns";
+
+		Benchmark::Result single;
+		single.name = std::string("loadChunkColumnData, ") + modeName + ", single thread";
+		single.unit = "loads";
+		single.items = LOADS_PER_TASK;
+		single.seconds = Benchmark::measureSeconds([&]() { loadColumns(0, hot); });
+		Benchmark::printResult(single);
+
+		const size_t threadCount = pool.getThreadCount();
+		Benchmark::Result parallel;
+		parallel.name = std::string("loadChunkColumnData, ") + modeName + ", thread pool";
+		parallel.unit = "loads";
+		parallel.items = static_cast<uint64_t>(LOADS_PER_TASK) * threadCount;
+		parallel.threads = threadCount;
+		parallel.seconds = Benchmark::measureSeconds([&]()
+			{
+				std::vector<std::future<void>> futures;
+				for (size_t task = 0; task < threadCount; task++)
+				{
+					futures.push_back(pool.enqueue(loadColumns, static_cast<int>(task), hot));
+				}
+				for (auto& future : futures)
+				{
+					future.wait();
+				}
+			});
+		Benchmark::printResult(parallel);
+	}
+
+	for (const ChunkColumnData* column : columns)
+	{
+		generator.releaseChunkColumnData(column);
+	}
+}
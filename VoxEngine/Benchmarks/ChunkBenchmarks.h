@@ -0,0 +1,21 @@
+#pragma once
+
+class ThreadPool;
+
+// Chunk hot paths on fixed fixtures: flat, hilly and cave terrain generated with seed 1337, and a
+// checkerboard, the worst case for meshing since every solid block shows all six faces.
+class ChunkBenchmarks
+{
+public:
+	// Chunk::buildBlocks with column data already loaded, chunks per second
+	static void runBuildBlocksBenchmark(ThreadPool& pool);
+
+	// CPU part of Chunk::buildMesh, chunks per second, with neighbours on every side
+	static void runMeshBenchmark();
+
+	// Chunk::getBlock_checkNeighbors over a chunk and its one block border, lookups per second
+	static void runNeighborLookupBenchmark();
+
+	// TerrainGenerator::loadChunkColumnData of loaded columns from every worker, few hot columns versus many
+	static void runColumnContentionBenchmark(ThreadPool& pool);
+};
@@ -0,0 +1,119 @@
+#include "CoreBenchmarks.h"
+
+#include "Benchmark.h"
+#include "Int2.h"
+#include "Int3.h"
+#include "ThreadPool.h"
+
+#include <iostream>
+#include <vector>
+#include <unordered_map>
+#include <future>
+
+template<typename Key, typename Hasher>
+static void runMapPasses(const std::vector<Key>& keys, const char* keyName)
+{
+	constexpr int REPEATS = 10;
+
+	std::unordered_map<Key, uint32_t, Hasher> map;
+	double insertSeconds = 0.0, findSeconds = 0.0, eraseSeconds = 0.0;
+	volatile uint64_t sink = 0;
+
+	// No reserve, like the world's chunk and column maps
+	for (int repeat = 0; repeat < REPEATS; repeat++)
+	{
+		insertSeconds += Benchmark::measureSeconds([&]()
+			{
+				for (size_t i = 0; i < keys.size(); i++)
+				{
+					map.emplace(keys[i], static_cast<uint32_t>(i));
+				}
+			});
+		findSeconds += Benchmark::measureSeconds([&]()
+			{
+				uint64_t sum = 0;
+				for (const Key& key : keys)
+				{
+					auto it = map.find(key);
+					sum += it != map.end() ? it->second : 0;
+				}
+				sink = sink + sum;
+			});
+		eraseSeconds += Benchmark::measureSeconds([&]()
+			{
+				for (const Key& key : keys)
+				{
+					map.erase(key);
+				}
+			});
+	}
+
+	const char* names[] = { "insert", "find", "erase" };
+	const double seconds[] = { insertSeconds, findSeconds, eraseSeconds };
+	for (int i = 0; i < 3; i++)
+	{
+		Benchmark::Result result;
+		result.name = std::string(keyName) + " map " + names[i];
+		result.unit = "ops";
+		result.items = static_cast<uint64_t>(REPEATS) * keys.size();
+		result.seconds = seconds[i];
+		Benchmark::printResult(result);
+	}
+}
+
+void CoreBenchmarks::runHashMapBenchmark()
+{
+	std::cout << "\n=== HASH MAP BENCHMARK ===\n";
+
+	// Loaded chunks around a player: 64x16x64, and the columns under a 256x256 area
+	std::vector<Int3> chunkKeys;
+	for (int x = -32; x < 32; x++)
+	{
+		for (int y = -8; y < 8; y++)
+		{
+			for (int z = -32; z < 32; z++)
+			{
+				chunkKeys.emplace_back(x, y, z);
+			}
+		}
+	}
+	runMapPasses<Int3, Int3Hasher>(chunkKeys, "Int3Hasher");
+
+	std::vector<Int2> columnKeys;
+	for (int x = -128; x < 128; x++)
+	{
+		for (int z = -128; z < 128; z++)
+		{
+			columnKeys.emplace_back(x, z);
+		}
+	}
+	runMapPasses<Int2, Int2Hasher>(columnKeys, "Int2Hasher");
+}
+
+void CoreBenchmarks::runThreadPoolBenchmark(ThreadPool& pool)
+{
+	std::cout << "\n=== THREAD POOL BENCHMARK ===\n";
+
+	constexpr int TASKS = 200000;
+
+	std::vector<std::future<void>> futures;
+	futures.reserve(TASKS);
+
+	Benchmark::Result result;
+	result.name = "ThreadPool::enqueue, empty tasks";
+	result.unit = "tasks";
+	result.items = TASKS;
+	result.threads = pool.getThreadCount();
+	result.seconds = Benchmark::measureSeconds([&]()
+		{
+			for (int i = 0; i < TASKS; i++)
+			{
+				futures.push_back(pool.enqueue([]() {}));
+			}
+			for (auto& future : futures)
+			{
+				future.wait();
+			}
+		});
+	Benchmark::printResult(result);
+}
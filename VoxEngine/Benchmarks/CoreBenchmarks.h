@@ -0,0 +1,13 @@
+#pragma once
+
+class ThreadPool;
+
+class CoreBenchmarks
+{
+public:
+	// Insert, find and erase in unordered maps keyed by Int3Hasher and Int2Hasher, over loaded area shaped keys
+	static void runHashMapBenchmark();
+
+	// ThreadPool::enqueue of empty tasks from one thread, tasks per second until all finished
+	static void runThreadPoolBenchmark(ThreadPool& pool);
+};
@@ -0,0 +1,438 @@
+#include "FlythroughBenchmark.h"
+
+#include "Benchmark.h"
+#include "../World.h"
+#include "../Graphics/ChunkMesh.h"
+#include "ThreadPool.h"
+#include "Histogram.h"
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <unordered_map>
+#include <random>
+#include <chrono>
+#include <thread>
+#include <cmath>
+#include <cstdio>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <unistd.h>
+#endif
+
+constexpr double FLYTHROUGH_TICK_RATE = 20.0; // Same as the windowed world update
+constexpr double FLYTHROUGH_DRAIN_SECONDS = 10.0; // After the path ends, chunks still generating get this long
+constexpr double FLYTHROUGH_PATH_SECONDS = 20.0;
+constexpr int FLYTHROUGH_RENDER_DISTANCE = 8;
+
+// Resident memory of the process, sampled every tick for the peak
+static size_t getResidentMemoryBytes()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+	{
+		return counters.WorkingSetSize;
+	}
+	return 0;
+#else
+	std::ifstream statm("/proc/self/statm");
+	size_t totalPages = 0, residentPages = 0;
+	if (!(statm >> totalPages >> residentPages))
+	{
+		return 0;
+	}
+	return residentPages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+void FlythroughBenchmark::Path::getPosition(double time, float& x, float& y, float& z) const
+{
+	if (points.empty())
+	{
+		x = y = z = 0.0f;
+		return;
+	}
+
+	// Last point at or before 'time', so a jump takes effect at its time
+	auto next = std::upper_bound(points.begin(), points.end(), time,
+		[](double value, const PathPoint& point) { return value < point.time; });
+	if (next == points.begin() || next == points.end())
+	{
+		const PathPoint& point = next == points.end() ? points.back() : points.front();
+		x = point.x;
+		y = point.y;
+		z = point.z;
+		return;
+	}
+
+	const PathPoint& a = *(next - 1);
+	const PathPoint& b = *next;
+	float t = static_cast<float>((time - a.time) / (b.time - a.time));
+	x = a.x + (b.x - a.x) * t;
+	y = a.y + (b.y - a.y) * t;
+	z = a.z + (b.z - a.z) * t;
+}
+
+FlythroughBenchmark::Path FlythroughBenchmark::createLinePath(double seconds, float speed)
+{
+	Path path;
+	path.name = "line";
+	path.points.push_back({ 0.0, 0.0f, 2.0f, 0.0f });
+	path.points.push_back({ seconds, speed * static_cast<float>(seconds), 2.0f, 0.0f });
+	return path;
+}
+
+// Outward spiral that also moves up and down, so new chunks come in from every side
+FlythroughBenchmark::Path FlythroughBenchmark::createSpiralPath(double seconds, float speed)
+{
+	Path path;
+	path.name = "spiral";
+
+	const double step = 0.1;
+	float angle = 0.0f;
+	for (double time = 0.0; time <= seconds + step * 0.5; time += step)
+	{
+		float radius = 16.0f + 4.0f * static_cast<float>(time);
+		path.points.push_back({ time, radius * std::cos(angle), 2.0f + 24.0f * std::sin(static_cast<float>(time) * 0.3f), radius * std::sin(angle) });
+		angle += speed * static_cast<float>(step) / radius;
+	}
+	return path;
+}
+
+// Jumps to a random position every interval, nothing loaded before can be reused
+FlythroughBenchmark::Path FlythroughBenchmark::createTeleportPath(double seconds, double interval, float distance, uint32_t seed)
+{
+	Path path;
+	path.name = "teleport";
+
+	std::mt19937 random(seed);
+	std::uniform_real_distribution<float> horizontal(-distance, distance);
+	std::uniform_real_distribution<float> vertical(-32.0f, 32.0f);
+
+	PathPoint point = { 0.0, 0.0f, 2.0f, 0.0f };
+	path.points.push_back(point);
+	for (double time = interval; time < seconds; time += interval)
+	{
+		point.time = time;
+		path.points.push_back(point); // Stays until the jump
+		point = { time, horizontal(random), vertical(random), horizontal(random) };
+		path.points.push_back(point);
+	}
+	point.time = seconds;
+	path.points.push_back(point);
+	return path;
+}
+
+bool FlythroughBenchmark::loadPath(const std::string& file, Path& path)
+{
+	std::ifstream input(file);
+	if (!input)
+	{
+		std::cerr << "FlythroughBenchmark: Failed to open " << file << "." << std::endl;
+		return false;
+	}
+
+	path.name = file;
+	path.points.clear();
+
+	std::string line;
+	while (std::getline(input, line))
+	{
+		line = line.substr(0, line.find('#'));
+		std::istringstream stream(line);
+		PathPoint point;
+		if (stream >> point.time >> point.x >> point.y >> point.z)
+		{
+			path.points.push_back(point);
+		}
+	}
+
+	std::stable_sort(path.points.begin(), path.points.end(),
+		[](const PathPoint& a, const PathPoint& b) { return a.time < b.time; });
+	if (path.points.empty())
+	{
+		std::cerr << "FlythroughBenchmark: " << file << " has no path points." << std::endl;
+		return false;
+	}
+	return true;
+}
+
+FlythroughBenchmark::Result FlythroughBenchmark::run(ThreadPool& pool, const Path& path, int renderDistance)
+{
+	using Clock = std::chrono::steady_clock;
+
+	struct TrackedChunk
+	{
+		Clock::time_point loadTime;
+		uint64_t lastSeenTick = 0;
+		bool ready = false; // Generated and meshed
+	};
+
+	Result result;
+	result.pathName = path.name;
+
+	// No save directory or column cache, every run generates from scratch
+	World world(pool, 1337, false);
+	std::unordered_map<Int3, TrackedChunk, Int3Hasher> trackedChunks;
+	std::vector<BlockFaceInstance> faces;
+	LogLinearHistogram latencies; // Microseconds
+	LogLinearHistogram tickTimes; // Microseconds
+
+	const double tickSeconds = 1.0 / FLYTHROUGH_TICK_RATE;
+	const auto tickDuration = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(tickSeconds));
+	const double duration = path.getDuration();
+
+	const auto start = Clock::now();
+	auto nextTick = start;
+	size_t peakMemory = getResidentMemoryBytes();
+	for (uint64_t tick = 1;; tick++)
+	{
+		// The path advances by whole ticks, so every run visits the same positions
+		const double pathTime = (tick - 1) * tickSeconds;
+		const bool draining = pathTime > duration;
+		if (draining && (pathTime > duration + FLYTHROUGH_DRAIN_SECONDS ||
+			(world.getGenerationTasksInFlight() == 0 && world.getStorageLoadsPending() == 0)))
+		{
+			break;
+		}
+
+		const auto tickStart = Clock::now();
+		float x, y, z;
+		path.getPosition(std::min(pathTime, duration), x, y, z);
+		world.loadChunksAroundPlayer(Int3(
+			static_cast<int>(std::floor(x / CHUNK_SIZE)),
+			static_cast<int>(std::floor(y / CHUNK_SIZE)),
+			static_cast<int>(std::floor(z / CHUNK_SIZE))), renderDistance);
+		world.updateGeneration();
+
+		// Chunks finished this tick are meshed right away, like World::update would
+		world.forEachChunk([&](const Chunk& chunk)
+			{
+				auto inserted = trackedChunks.emplace(chunk.getPosition(), TrackedChunk());
+				TrackedChunk& tracked = inserted.first->second;
+				tracked.lastSeenTick = tick;
+				if (inserted.second)
+				{
+					tracked.loadTime = tickStart;
+					result.chunksLoaded++;
+				}
+				if (tracked.ready || chunk.getGenerationStage() < static_cast<int>(GenerationStage::Count))
+				{
+					return;
+				}
+
+				auto meshStart = Clock::now();
+				faces.clear();
+				chunk.buildMeshData(faces);
+				auto meshEnd = Clock::now();
+
+				tracked.ready = true;
+				result.chunksGenerated++;
+				result.facesMeshed += faces.size();
+				result.meshSeconds += std::chrono::duration<double>(meshEnd - meshStart).count();
+				latencies.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(meshEnd - tracked.loadTime).count()));
+			});
+
+		// Unloaded before it was ready
+		for (auto it = trackedChunks.begin(); it != trackedChunks.end();)
+		{
+			if (it->second.lastSeenTick != tick)
+			{
+				result.chunksUnfinished += it->second.ready ? 0 : 1;
+				it = trackedChunks.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
+
+		const auto tickEnd = Clock::now();
+		tickTimes.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(tickEnd - tickStart).count()));
+		peakMemory = std::max(peakMemory, getResidentMemoryBytes());
+		result.ticks = tick;
+
+		nextTick += tickDuration;
+		if (tickEnd > nextTick)
+		{
+			nextTick = tickEnd;
+		}
+		else
+		{
+			std::this_thread::sleep_until(nextTick);
+		}
+	}
+	result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+	for (const auto& pair : trackedChunks)
+	{
+		result.chunksUnfinished += pair.second.ready ? 0 : 1;
+	}
+
+	result.latencyP50 = latencies.getValueAtPercentile(50.0) / 1000.0;
+	result.latencyP90 = latencies.getValueAtPercentile(90.0) / 1000.0;
+	result.latencyP99 = latencies.getValueAtPercentile(99.0) / 1000.0;
+	result.latencyMax = latencies.getValueAtPercentile(100.0) / 1000.0;
+	result.tickP50 = tickTimes.getValueAtPercentile(50.0) / 1000.0;
+	result.tickP99 = tickTimes.getValueAtPercentile(99.0) / 1000.0;
+	result.tickMax = tickTimes.getValueAtPercentile(100.0) / 1000.0;
+	result.peakMemoryBytes = peakMemory;
+	return result;
+}
+
+// Path names come from file names, quotes, backslashes and control characters are escaped for JSON
+static std::string escapeJson(const std::string& text)
+{
+	std::string escaped;
+	escaped.reserve(text.size());
+	for (char character : text)
+	{
+		const unsigned char code = static_cast<unsigned char>(character);
+		if (character == '"' || character == '\\')
+		{
+			escaped += '\\';
+			escaped += character;
+		}
+		else if (code < 0x20)
+		{
+			char buffer[8];
+			std::snprintf(buffer, sizeof(buffer), "\\u%04x", code);
+			escaped += buffer;
+		}
+		else
+		{
+			escaped += character;
+		}
+	}
+	return escaped;
+}
+
+bool FlythroughBenchmark::writeJson(const std::string& file, const std::vector<Result>& results, size_t threads, int renderDistance)
+{
+	std::ofstream output(file);
+	if (!output)
+	{
+		return false;
+	}
+
+	output << std::fixed << std::setprecision(3);
+	output << "{\n  \"benchmark\": \"flythrough\",\n  \"threads\": " << threads << ",\n  \"renderDistance\": " << renderDistance
+		<< ",\n  \"tickRate\": " << FLYTHROUGH_TICK_RATE << ",\n  \"runs\": [";
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const Result& result = results[i];
+		output << (i == 0 ? "\n" : ",\n")
+			<< "    {\n"
+			<< "      \"path\": \"" << escapeJson(result.pathName) << "\",\n"
+			<< "      \"seconds\": " << result.seconds << ",\n"
+			<< "      \"ticks\": " << result.ticks << ",\n"
+			<< "      \"chunksLoaded\": " << result.chunksLoaded << ",\n"
+			<< "      \"chunksGenerated\": " << result.chunksGenerated << ",\n"
+			<< "      \"chunksUnfinished\": " << result.chunksUnfinished << ",\n"
+			<< "      \"chunksPerSecond\": " << (result.seconds > 0.0 ? result.chunksGenerated / result.seconds : 0.0) << ",\n"
+			<< "      \"facesMeshed\": " << result.facesMeshed << ",\n"
+			<< "      \"meshedChunksPerSecond\": " << (result.meshSeconds > 0.0 ? result.chunksGenerated / result.meshSeconds : 0.0) << ",\n"
+			<< "      \"latencyMs\": { \"p50\": " << result.latencyP50 << ", \"p90\": " << result.latencyP90
+			<< ", \"p99\": " << result.latencyP99 << ", \"max\": " << result.latencyMax << " },\n"
+			<< "      \"tickMs\": { \"p50\": " << result.tickP50 << ", \"p99\": " << result.tickP99 << ", \"max\": " << result.tickMax << " },\n"
+			<< "      \"peakMemoryBytes\": " << result.peakMemoryBytes << "\n"
+			<< "    }";
+	}
+	output << "\n  ]\n}\n";
+	return output.good();
+}
+
+static void printFlythroughResult(const FlythroughBenchmark::Result& result, size_t threads)
+{
+	std::cout << std::fixed << std::setprecision(1)
+		<< "Path " << result.pathName << ": " << result.chunksGenerated << " of " << result.chunksLoaded << " chunks ready, time to ready p50 "
+		<< result.latencyP50 << " ms, p99 " << result.latencyP99 << " ms, tick p99 " << result.tickP99 << " ms, peak memory "
+		<< result.peakMemoryBytes / (1024.0 * 1024.0) << " MB" << std::endl;
+
+	Benchmark::Result generation;
+	generation.name = "Flythrough " + result.pathName + " generation";
+	generation.seconds = result.seconds;
+	generation.items = result.chunksGenerated;
+	generation.unit = "chunks";
+	generation.threads = threads;
+	Benchmark::printResult(generation);
+
+	Benchmark::Result meshing;
+	meshing.name = "Flythrough " + result.pathName + " meshing";
+	meshing.seconds = result.meshSeconds;
+	meshing.items = result.chunksGenerated;
+	meshing.unit = "chunks";
+	Benchmark::printResult(meshing);
+}
+
+void FlythroughBenchmark::runAll(ThreadPool& pool)
+{
+	std::cout << "\n=== FLYTHROUGH BENCHMARK ===\n";
+
+	std::vector<Path> paths =
+	{
+		createLinePath(FLYTHROUGH_PATH_SECONDS, 20.0f),
+		createSpiralPath(FLYTHROUGH_PATH_SECONDS, 20.0f),
+		createTeleportPath(FLYTHROUGH_PATH_SECONDS, 2.0, 4096.0f, 1337)
+	};
+
+	std::vector<Result> results;
+	for (const Path& path : paths)
+	{
+		results.push_back(run(pool, path, FLYTHROUGH_RENDER_DISTANCE));
+		printFlythroughResult(results.back(), pool.getThreadCount());
+	}
+
+	if (writeJson("flythrough.json", results, pool.getThreadCount(), FLYTHROUGH_RENDER_DISTANCE))
+	{
+		std::cout << "Results written to flythrough.json" << std::endl;
+	}
+}
+
+int FlythroughBenchmark::runFromArguments(int argc, char** argv)
+{
+	if (argc < 1)
+	{
+		std::cerr << "Usage: VoxEngine --flythrough <line|spiral|teleport|path file> [output.json]" << std::endl;
+		return -1;
+	}
+
+	std::string name = argv[0];
+	Path path;
+	if (name == "line")
+	{
+		path = createLinePath(FLYTHROUGH_PATH_SECONDS, 20.0f);
+	}
+	else if (name == "spiral")
+	{
+		path = createSpiralPath(FLYTHROUGH_PATH_SECONDS, 20.0f);
+	}
+	else if (name == "teleport")
+	{
+		path = createTeleportPath(FLYTHROUGH_PATH_SECONDS, 2.0, 4096.0f, 1337);
+	}
+	else if (!loadPath(name, path))
+	{
+		return -1;
+	}
+
+	std::string output = argc >= 2 ? argv[1] : "flythrough.json";
+	ThreadPool& pool = ParallelUtils::getGlobalThreadPool();
+	Result result = run(pool, path, FLYTHROUGH_RENDER_DISTANCE);
+	printFlythroughResult(result, pool.getThreadCount());
+	if (!writeJson(output, { result }, pool.getThreadCount(), FLYTHROUGH_RENDER_DISTANCE))
+	{
+		std::cerr << "FlythroughBenchmark: Failed to write " << output << "." << std::endl;
+		return 1;
+	}
+	std::cout << "Results written to " << output << std::endl;
+	return 0;
+}
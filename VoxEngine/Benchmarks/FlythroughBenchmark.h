@@ -0,0 +1,58 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+class ThreadPool;
+
+// Replays a camera path against a headless world at the windowed game's 20 Hz world update and measures the
+// chunk pipeline: time from load until a chunk is generated and meshed, chunks generated and meshed per second,
+// tick times and peak memory. Meshing is the CPU part only, there is no OpenGL context.
+// Results are printed and written as JSON for regression tracking.
+// VoxEngine --benchmark flythrough, or VoxEngine --flythrough <line|spiral|teleport|path file> [output.json]
+class FlythroughBenchmark
+{
+public:
+	struct PathPoint
+	{
+		double time; // Seconds from the start
+		float x, y, z; // Block coordinates
+	};
+
+	// Positions are interpolated between points, two points with the same time are a jump
+	struct Path
+	{
+		std::string name;
+		std::vector<PathPoint> points;
+
+		double getDuration() const { return points.empty() ? 0.0 : points.back().time; }
+		void getPosition(double time, float& x, float& y, float& z) const;
+	};
+
+	struct Result
+	{
+		std::string pathName;
+		double seconds = 0.0;
+		uint64_t ticks = 0;
+		uint64_t chunksLoaded = 0;
+		uint64_t chunksGenerated = 0;
+		uint64_t chunksUnfinished = 0; // Unloaded or still generating at the end
+		uint64_t facesMeshed = 0;
+		double meshSeconds = 0.0; // Spent building mesh data
+		double latencyP50 = 0.0, latencyP90 = 0.0, latencyP99 = 0.0, latencyMax = 0.0; // Milliseconds
+		double tickP50 = 0.0, tickP99 = 0.0, tickMax = 0.0; // Milliseconds
+		size_t peakMemoryBytes = 0;
+	};
+
+	static Path createLinePath(double seconds, float speed);
+	static Path createSpiralPath(double seconds, float speed);
+	static Path createTeleportPath(double seconds, double interval, float distance, uint32_t seed);
+	static bool loadPath(const std::string& file, Path& path); // "time x y z" per line, '#' starts a comment
+
+	static Result run(ThreadPool& pool, const Path& path, int renderDistance);
+	static bool writeJson(const std::string& file, const std::vector<Result>& results, size_t threads, int renderDistance);
+
+	static void runAll(ThreadPool& pool); // Every parametric path, written to flythrough.json
+	static int runFromArguments(int argc, char** argv); // Arguments after --flythrough
+};
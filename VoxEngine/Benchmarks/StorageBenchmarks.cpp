@@ -0,0 +1,278 @@
+#include "StorageBenchmarks.h"
+
+#include "Benchmark.h"
+#include "../TerrainGenerator.h"
+#include "../Storage/ChunkCodec.h"
+#include "../Storage/RegionFile.h"
+
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <cstdio>
+#include <cstring>
+
+// 16x16 columns, four chunk layers around the surface, split between two region files
+constexpr int STORAGE_REGION_XZ = 16;
+constexpr int STORAGE_MIN_Y = -2;
+constexpr int STORAGE_MAX_Y = 2;
+
+using RegionFileMap = std::unordered_map<Int3, std::unique_ptr<RegionFile>, Int3Hasher>;
+
+static RegionFile& getRegionFile(RegionFileMap& regionFiles, const Int3& chunkPosition)
+{
+	Int3 regionPosition = RegionFile::getRegionPosition(chunkPosition);
+	std::unique_ptr<RegionFile>& regionFile = regionFiles[regionPosition];
+	if (!regionFile)
+	{
+		regionFile = std::make_unique<RegionFile>();
+		regionFile->open("benchmark_" + RegionFile::getFileName(regionPosition));
+	}
+	return *regionFile;
+}
+
+static size_t getFileSize(const std::string& path)
+{
+	FILE* file = std::fopen(path.c_str(), "rb");
+	if (!file)
+	{
+		return 0;
+	}
+	std::fseek(file, 0, SEEK_END);
+	long size = std::ftell(file);
+	std::fclose(file);
+	return size > 0 ? static_cast<size_t>(size) : 0;
+}
+
+static size_t getTotalFileSize(const std::vector<Int3>& positions)
+{
+	std::vector<Int3> regions;
+	size_t total = 0;
+	for (const Int3& position : positions)
+	{
+		Int3 region = RegionFile::getRegionPosition(position);
+		bool counted = false;
+		for (const Int3& other : regions)
+		{
+			counted |= other == region;
+		}
+		if (!counted)
+		{
+			regions.push_back(region);
+			total += getFileSize("benchmark_" + RegionFile::getFileName(region));
+		}
+	}
+	return total;
+}
+
+void StorageBenchmarks::runRegionBenchmark()
+{
+	std::cout << "\n=== REGION FILE BENCHMARK ===\n";
+
+	std::vector<Int3> positions;
+	for (int x = 0; x < STORAGE_REGION_XZ; x++)
+	{
+		for (int y = STORAGE_MIN_Y; y < STORAGE_MAX_Y; y++)
+		{
+			for (int z = 0; z < STORAGE_REGION_XZ; z++)
+			{
+				positions.emplace_back(x, y, z);
+			}
+		}
+	}
+	const size_t chunkCount = positions.size();
+
+	// Terrain stage output is what a stored chunk replaces
+	TerrainGenerator generator(1337);
+	std::vector<Block> blocks(chunkCount * CHUNK_VOLUME);
+	std::vector<char> uniform(chunkCount);
+	std::vector<Block> uniformBlocks(chunkCount);
+
+	Benchmark::Result generateResult;
+	generateResult.name = "Regenerate, single thread";
+	generateResult.unit = "chunks";
+	generateResult.items = chunkCount;
+	generateResult.seconds = Benchmark::measureSeconds([&]()
+		{
+			for (size_t i = 0; i < chunkCount; i++)
+			{
+				const Int3& p = positions[i];
+				const ChunkColumnData* column = generator.loadChunkColumnData(p.x, p.z);
+				Block uniformBlock;
+				uniform[i] = generator.classifyUniformChunk(p.y, column, uniformBlock);
+				uniformBlocks[i] = uniformBlock;
+				if (!uniform[i])
+				{
+					generator.generateChunkBlocks(p.x, p.y, p.z, column, &blocks[i * CHUNK_VOLUME]);
+				}
+				generator.releaseChunkColumnData(column);
+			}
+		});
+	Benchmark::printResult(generateResult);
+
+	// Encode and write
+	RegionFileMap regionFiles;
+	std::vector<uint8_t> payload;
+	size_t payloadBytes = 0;
+
+	Benchmark::Result writeResult;
+	writeResult.name = "Encode and write, single thread";
+	writeResult.unit = "chunks";
+	writeResult.items = chunkCount;
+	writeResult.seconds = Benchmark::measureSeconds([&]()
+		{
+			for (size_t i = 0; i < chunkCount; i++)
+			{
+				payload.clear();
+				if (uniform[i])
+				{
+					ChunkCodec::encodeUniform(uniformBlocks[i], payload);
+				}
+				else
+				{
+					ChunkCodec::encode(&blocks[i * CHUNK_VOLUME], payload);
+				}
+				payloadBytes += payload.size();
+
+				getRegionFile(regionFiles, positions[i]).write(RegionFile::getLocalIndex(positions[i]), payload.data(), payload.size());
+			}
+			for (auto& regionFile : regionFiles)
+			{
+				regionFile.second->flush();
+			}
+		});
+	Benchmark::printResult(writeResult);
+	regionFiles.clear();
+
+	// Read back from freshly opened files and verify
+	std::vector<Block> decoded(CHUNK_VOLUME);
+	size_t mismatches = 0;
+
+	Benchmark::Result readResult;
+	readResult.name = "Read and decode, single thread";
+	readResult.unit = "chunks";
+	readResult.items = chunkCount;
+	readResult.seconds = Benchmark::measureSeconds([&]()
+		{
+			for (size_t i = 0; i < chunkCount; i++)
+			{
+				bool decodedUniform = false;
+				Block decodedUniformBlock = Block::Air;
+				bool ok = getRegionFile(regionFiles, positions[i]).read(RegionFile::getLocalIndex(positions[i]), payload)
+					&& ChunkCodec::decode(payload.data(), payload.size(), decoded.data(), decodedUniform, decodedUniformBlock);
+
+				bool same = ok && decodedUniform == (uniform[i] != 0) && (decodedUniform
+					? decodedUniformBlock == uniformBlocks[i]
+					: memcmp(decoded.data(), &blocks[i * CHUNK_VOLUME], CHUNK_VOLUME * sizeof(Block)) == 0);
+				mismatches += same ? 0 : 1;
+			}
+		});
+	Benchmark::printResult(readResult);
+
+	size_t fileBytes = getTotalFileSize(positions);
+	std::cout << "Payload: " << payloadBytes / chunkCount << " bytes per chunk, files: " << fileBytes / 1024 << " KiB, "
+		<< "load is " << generateResult.seconds / readResult.seconds << "x faster than regeneration, "
+		<< mismatches << " mismatches" << std::endl;
+
+	// Rewrite every chunk twice, then compact away the freed sectors
+	for (int pass = 0; pass < 2; pass++)
+	{
+		for (size_t i = 0; i < chunkCount; i++)
+		{
+			getRegionFile(regionFiles, positions[i]).read(RegionFile::getLocalIndex(positions[i]), payload);
+			getRegionFile(regionFiles, positions[i]).write(RegionFile::getLocalIndex(positions[i]), payload.data(), payload.size());
+		}
+	}
+	size_t freeSectors = 0;
+	for (auto& regionFile : regionFiles)
+	{
+		regionFile.second->flush();
+		freeSectors += regionFile.second->getFreeSectorCount();
+	}
+	size_t fragmentedBytes = getTotalFileSize(positions);
+
+	Benchmark::Result compactResult;
+	compactResult.name = "Compact region files";
+	compactResult.unit = "files";
+	compactResult.items = regionFiles.size();
+	compactResult.seconds = Benchmark::measureSeconds([&]()
+		{
+			for (auto& regionFile : regionFiles)
+			{
+				regionFile.second->compact();
+			}
+		});
+	Benchmark::printResult(compactResult);
+	regionFiles.clear();
+
+	std::cout << "After rewrites: " << fragmentedBytes / 1024 << " KiB with " << freeSectors << " free sectors, compacted: "
+		<< getTotalFileSize(positions) / 1024 << " KiB" << std::endl;
+
+	for (const Int3& position : positions)
+	{
+		std::remove(("benchmark_" + RegionFile::getFileName(RegionFile::getRegionPosition(position))).c_str());
+	}
+}
+
+void StorageBenchmarks::runDeltaBenchmark()
+{
+	std::cout << "\n=== CHUNK DELTA BENCHMARK ===\n";
+
+	constexpr int EDITS_PER_CHUNK = 16;
+
+	TerrainGenerator generator(1337);
+	const ChunkCodec::DeltaStamp stamp = { TerrainGenerator::GENERATOR_VERSION, generator.getSeed() };
+
+	std::vector<Block> baseBlocks(CHUNK_VOLUME);
+	std::vector<Block> editedBlocks(CHUNK_VOLUME);
+	std::vector<uint8_t> payload;
+	size_t fullBytes = 0;
+	size_t deltaBytes = 0;
+	size_t chunkCount = 0;
+	size_t mismatches = 0;
+
+	Benchmark::Result result;
+	result.name = "Delta encode with regeneration, single thread";
+	result.unit = "chunks";
+	result.seconds = Benchmark::measureSeconds([&]()
+		{
+			for (int x = 0; x < STORAGE_REGION_XZ; x++)
+			{
+				for (int y = STORAGE_MIN_Y; y < STORAGE_MAX_Y; y++)
+				{
+					for (int z = 0; z < STORAGE_REGION_XZ; z++)
+					{
+						// A few player edits at hashed positions
+						Int3 position(x, y, z);
+						generator.generateBaseChunk(position, editedBlocks.data());
+						uint32_t hash = static_cast<uint32_t>(x * 73856093 ^ y * 19349663 ^ z * 83492791);
+						for (int i = 0; i < EDITS_PER_CHUNK; i++)
+						{
+							hash = hash * 1664525u + 1013904223u;
+							editedBlocks[(hash >> 8) % CHUNK_VOLUME] = (hash & 1) ? Block::Air : Block::Wood;
+						}
+
+						payload.clear();
+						ChunkCodec::encode(editedBlocks.data(), payload);
+						fullBytes += payload.size();
+
+						generator.generateBaseChunk(position, baseBlocks.data());
+						payload.clear();
+						ChunkCodec::encodeDelta(editedBlocks.data(), baseBlocks.data(), stamp, payload);
+						deltaBytes += payload.size();
+
+						if (!ChunkCodec::applyDelta(payload.data(), payload.size(), baseBlocks.data()) || baseBlocks != editedBlocks)
+						{
+							mismatches++;
+						}
+						chunkCount++;
+					}
+				}
+			}
+		});
+	result.items = chunkCount;
+	Benchmark::printResult(result);
+
+	std::cout << "Full: " << fullBytes / chunkCount << " bytes per chunk, delta: " << deltaBytes / chunkCount
+		<< " bytes per chunk, " << mismatches << " mismatches" << std::endl;
+}
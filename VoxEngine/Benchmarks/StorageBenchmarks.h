@@ -0,0 +1,11 @@
+#pragma once
+
+class StorageBenchmarks
+{
+public:
+	// Region file round trip: encode and write, read and decode, compaction. Compared against regeneration.
+	static void runRegionBenchmark();
+
+	// Edited chunks stored in full versus as deltas against the generator, size and encode rate
+	static void runDeltaBenchmark();
+};
@@ -0,0 +1,202 @@
+#include "TerrainBenchmarks.h"
+
+#include "Benchmark.h"
+#include "../TerrainGenerator.h"
+#include "../ColumnDiskCache.h"
+#include "ThreadPool.h"
+
+#include <iostream>
+#include <vector>
+#include <atomic>
+#include <cstdio>
+
+// Fixed region so results are comparable between runs
+constexpr int REGION_SIZE_XZ = 16;
+constexpr int REGION_SIZE_Y = 8;
+constexpr int REGION_MIN_Y = -4;
+
+static void generateRegion(TerrainGenerator& generator, const std::vector<const ChunkColumnData*>& columns, int chunkYBegin, int chunkYEnd)
+{
+	static thread_local Block blocks[CHUNK_VOLUME];
+	for (const ChunkColumnData* column : columns)
+	{
+		for (int y = chunkYBegin; y < chunkYEnd; y++)
+		{
+			generator.generateChunkBlocks(column->X, y, column->Z, column, blocks);
+		}
+	}
+}
+
+static Benchmark::Result runDensityPass(TerrainGenerator& generator, ThreadPool& pool, const std::vector<const ChunkColumnData*>& columns, const char* name, bool parallel)
+{
+	Benchmark::Result result;
+	result.name = name;
+	result.unit = "chunks";
+	result.items = columns.size() * REGION_SIZE_Y;
+
+	if (!parallel)
+	{
+		result.threads = 1;
+		result.seconds = Benchmark::measureSeconds([&]()
+			{
+				generateRegion(generator, columns, REGION_MIN_Y, REGION_MIN_Y + REGION_SIZE_Y);
+			});
+		return result;
+	}
+
+	result.threads = pool.getThreadCount();
+	result.seconds = Benchmark::measureSeconds([&]()
+		{
+			// One task per chunk layer keeps every worker busy
+			std::vector<std::future<void>> futures;
+			for (int y = REGION_MIN_Y; y < REGION_MIN_Y + REGION_SIZE_Y; y++)
+			{
+				futures.push_back(pool.enqueue([&generator, &columns, y]()
+					{
+						generateRegion(generator, columns, y, y + 1);
+					}));
+			}
+			for (auto& future : futures)
+			{
+				future.wait();
+			}
+		});
+	return result;
+}
+
+void TerrainBenchmarks::runDensityBenchmark(ThreadPool& pool)
+{
+	std::cout << "\n=== DENSITY GENERATION BENCHMARK ===\n";
+
+	TerrainGenerator generator(1337);
+
+	// Height maps aren't part of the measurement
+	std::vector<const ChunkColumnData*> columns;
+	for (int x = 0; x < REGION_SIZE_XZ; x++)
+	{
+		for (int z = 0; z < REGION_SIZE_XZ; z++)
+		{
+			columns.push_back(generator.loadChunkColumnData(x, z));
+		}
+	}
+
+	// Warm up
+	generateRegion(generator, columns, 0, 1);
+
+	const int resolutions[] = { 1, 2, 4 };
+	for (int resolution : resolutions)
+	{
+		generator.setDensityResolution(resolution);
+
+		std::string name = "Density, resolution " + std::to_string(resolution);
+		Benchmark::printResult(runDensityPass(generator, pool, columns, (name + ", single thread").c_str(), false));
+		Benchmark::printResult(runDensityPass(generator, pool, columns, (name + ", thread pool").c_str(), true));
+	}
+
+	generator.setDensityEnabled(false);
+	Benchmark::printResult(runDensityPass(generator, pool, columns, "Height map only, single thread", false));
+	generator.setDensityEnabled(true);
+
+	for (const ChunkColumnData* column : columns)
+	{
+		generator.releaseChunkColumnData(column);
+	}
+}
+
+// Every load misses the cache and every release evicts, so each iteration generates the column
+static Benchmark::Result runColumnPass(TerrainGenerator& generator, ThreadPool& pool, const char* name, int firstColumn, int regionSize, bool parallel)
+{
+	Benchmark::Result result;
+	result.name = name;
+	result.unit = "columns";
+	result.items = static_cast<uint64_t>(regionSize) * regionSize;
+
+	auto generateRow = [&generator, firstColumn, regionSize](int x)
+		{
+			for (int z = firstColumn; z < firstColumn + regionSize; z++)
+			{
+				generator.releaseChunkColumnData(generator.loadChunkColumnData(x, z));
+			}
+		};
+
+	if (!parallel)
+	{
+		result.threads = 1;
+		result.seconds = Benchmark::measureSeconds([&]()
+			{
+				for (int x = firstColumn; x < firstColumn + regionSize; x++)
+				{
+					generateRow(x);
+				}
+			});
+		return result;
+	}
+
+	result.threads = pool.getThreadCount();
+	result.seconds = Benchmark::measureSeconds([&]()
+		{
+			std::vector<std::future<void>> futures;
+			for (int x = firstColumn; x < firstColumn + regionSize; x++)
+			{
+				futures.push_back(pool.enqueue(generateRow, x));
+			}
+			for (auto& future : futures)
+			{
+				future.wait();
+			}
+		});
+	return result;
+}
+
+void TerrainBenchmarks::runBiomeBenchmark(ThreadPool& pool)
+{
+	std::cout << "\n=== BIOME COLUMN BENCHMARK ===\n";
+
+	constexpr int COLUMN_REGION_SIZE = 64;
+	constexpr int FIRST_COLUMN = 1000;
+
+	TerrainGenerator generator(1337);
+
+	// Warm up
+	runColumnPass(generator, pool, "Warm up", FIRST_COLUMN, 8, false);
+
+	generator.setBiomesEnabled(true);
+	Benchmark::printResult(runColumnPass(generator, pool, "Columns with biomes, single thread", FIRST_COLUMN, COLUMN_REGION_SIZE, false));
+	Benchmark::printResult(runColumnPass(generator, pool, "Columns with biomes, thread pool", FIRST_COLUMN, COLUMN_REGION_SIZE, true));
+
+	generator.setBiomesEnabled(false);
+	Benchmark::printResult(runColumnPass(generator, pool, "Columns without biomes, single thread", FIRST_COLUMN, COLUMN_REGION_SIZE, false));
+	Benchmark::printResult(runColumnPass(generator, pool, "Columns without biomes, thread pool", FIRST_COLUMN, COLUMN_REGION_SIZE, true));
+	generator.setBiomesEnabled(true);
+}
+
+void TerrainBenchmarks::runColumnCacheBenchmark(ThreadPool& pool)
+{
+	std::cout << "\n=== COLUMN DISK CACHE BENCHMARK ===\n";
+
+	constexpr int COLUMN_REGION_SIZE = 64;
+	constexpr int FIRST_COLUMN = 2000;
+	const char* cachePath = "benchmark_columns.cache";
+	std::remove(cachePath);
+
+	// Cold pass generates and stores every column, the second generator only reads them back
+	{
+		TerrainGenerator generator(1337);
+		generator.openColumnDiskCache(cachePath, COLUMN_REGION_SIZE * COLUMN_REGION_SIZE * 2);
+		Benchmark::printResult(runColumnPass(generator, pool, "Cold cache, thread pool", FIRST_COLUMN, COLUMN_REGION_SIZE, true));
+	}
+	{
+		TerrainGenerator generator(1337);
+		generator.openColumnDiskCache(cachePath, COLUMN_REGION_SIZE * COLUMN_REGION_SIZE * 2);
+		Benchmark::printResult(runColumnPass(generator, pool, "Warm cache, single thread", FIRST_COLUMN, COLUMN_REGION_SIZE, false));
+		Benchmark::printResult(runColumnPass(generator, pool, "Warm cache, thread pool", FIRST_COLUMN, COLUMN_REGION_SIZE, true));
+
+		const ColumnDiskCache* cache = generator.getColumnDiskCache();
+		if (cache)
+		{
+			std::cout << "Hits: " << cache->getHitCount() << ", misses: " << cache->getMissCount() << std::endl;
+		}
+	}
+
+	std::remove(cachePath);
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+class ThreadPool;
+
+class TerrainBenchmarks
+{
+public:
+	// 3D density generation and thresholding, chunks per second single threaded and on the thread pool
+	static void runDensityBenchmark(ThreadPool& pool);
+
+	// Column data (height map and biome blending) with biomes on and off, columns per second
+	static void runBiomeBenchmark(ThreadPool& pool);
+
+	// Column data generated versus read back from the disk cache, columns per second
+	static void runColumnCacheBenchmark(ThreadPool& pool);
+};
@@ -0,0 +1,24 @@
+#pragma once
+#include "Block.h"
+
+#include <cstdint>
+
+enum class Biome : uint8_t
+{
+	Plains,
+	Forest,
+	Desert,
+	Mountains,
+	Tundra,
+	Count
+};
+
+// Height parameters are blended across biome borders, the rest is taken from the block's own biome
+struct BiomeParams
+{
+	float heightScale;  // Multiplies the height noise amplitude
+	float heightOffset; // Added to the base height
+	Block surfaceBlock;
+	Block fillerBlock;  // Below the surface block
+	uint32_t treeChance; // One tree in 'treeChance' columns, 0 for none
+};
@@ -1,8 +1,16 @@
 #pragma once
 #include <cstdint>
 
+// Every block except Air is opaque. Values are packed into 4 bits of the face instance data.
 enum class Block : uint8_t
 {
 	Air = 0,
-	Solid = 1
+	Solid = 1, // Stone
+	Dirt = 2,
+	Grass = 3,
+	Wood = 4,
+	Leaves = 5,
+	Ore = 6,
+	Sand = 7,
+	Snow = 8
 };
@@ -1,72 +1,26 @@
 #include "Chunk.h"
 
-#include "Vec2.h"
+#include "Graphics/ChunkMesh.h"
 #include "Profiler.h"
 
 #include <cassert>
 #include <vector>
 #include <iostream>
+#include <algorithm>
 #include "TerrainGenerator.h"
 
-//============================================================================
-//BlockFaceInstance
-
-struct BlockFaceInstance
-{
-	int32_t data;
-
-	BlockFaceInstance(int x, int y, int z, int normal) : data(0)
-	{
-		// Coords 12 bits
-		data |= (x & 15);
-		data |= (y & 15) << 4;
-		data |= (z & 15) << 8;
-
-		// Normal 3 bits
-		data |= (normal & 7) << 12;
-	}
-};
-
 //============================================================================
 // Chunk
 
 size_t Chunk::getIndex(int x, int y, int z)
 {
-	return (x << 8) | (y << 4) | z;
+	return getChunkBlockIndex(x, y, z);
 }
 
 Chunk::Chunk() :
 	position(0, 0, 0),
-	vao(0), vbo(0), instanceVBO(0), faceCount(0), faceCapacity(0)
+	generator(nullptr), chunkColumnData(nullptr)
 {
-	// Create buffers once
-	Vec2 vertices[4] = // CCW order
-	{
-		{ 0.0f, 0.0f },
-		{ 1.0f, 0.0f },
-		{ 1.0f, 1.0f },
-		{ 0.0f, 1.0f }
-	};
-
-	glGenVertexArrays(1, &vao);
-	glGenBuffers(1, &vbo);
-	glGenBuffers(1, &instanceVBO);
-
-	// Bind VAO
-	glBindVertexArray(vao);
-
-	// Vertex buffer
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vec2), (void*)0);
-
-	// Instance buffer
-	glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
-	glEnableVertexAttribArray(1);
-	glVertexAttribIPointer(1, 1, GL_INT, sizeof(BlockFaceInstance), (void*)0); // integer attribute
-	glVertexAttribDivisor(1, 1); // advance per instance
-
 	// Neighbours are null
 	for (int i = 0; i < 6; i++)
 	{
@@ -77,25 +31,6 @@ Chunk::Chunk() :
 Chunk::~Chunk()
 {
 	destroy(); // Just in case
-
-	// Delete buffers
-	if (instanceVBO)
-	{
-		glDeleteBuffers(1, &instanceVBO);
-		instanceVBO = 0;
-	}
-	if (vbo)
-	{
-		glDeleteBuffers(1, &vbo);
-		vbo = 0;
-	}
-	if (vao)
-	{
-		glDeleteVertexArrays(1, &vao);
-		vao = 0;
-	}
-
-	faceCapacity = 0;
 }
 
 bool Chunk::operator==(const Chunk& other) const
@@ -119,7 +54,10 @@ void Chunk::init(int x, int y, int z, Chunk** neighbors)
 	}*/
 
 	// Set instance count to 0
-	faceCount = 0;
+	if (mesh)
+	{
+		mesh->clear();
+	}
 
 	// Set neighbours
 	for (int i = 0; i < 6; i++)
@@ -133,7 +71,14 @@ void Chunk::init(int x, int y, int z, Chunk** neighbors)
 	}
 
 	//
-	loadedChunkColumnData = false;
+	generator = nullptr;
+	chunkColumnData = nullptr;
+	uniform = false;
+	generationStage = 0;
+	generationLocked = false;
+	relightPending = false;
+	modified = false;
+	unsaved = false;
 
 	// Reset state
 	state.store(State::NeedsBlocks, std::memory_order_release);
@@ -143,7 +88,10 @@ void Chunk::init(int x, int y, int z, Chunk** neighbors)
 void Chunk::destroy()
 {
 	// Set instance count to 0
-	faceCount = 0;
+	if (mesh)
+	{
+		mesh->clear();
+	}
 
 	// Clear neighbors
 	for (int i = 0; i < 6; i++)
@@ -157,126 +105,128 @@ void Chunk::destroy()
 	}
 
 	// Release chunk column data
-	if (loadedChunkColumnData)
+	if (chunkColumnData)
 	{
-		TerrainGenerator::getInstance().releaseChunkColumnData(position.x, position.z);
+		generator->releaseChunkColumnData(chunkColumnData);
+		chunkColumnData = nullptr;
 	}
 
 	// State can be not reset, because who cares?
 }
 
 // Fills 'blocks' array
-void Chunk::buildBlocks()
+void Chunk::buildBlocks(TerrainGenerator& generator)
 {
-	auto chunkColumnData = TerrainGenerator::getInstance().loadChunkColumnData(position.x, position.z);
-	const int* heightMap = chunkColumnData->heightMap;
-	loadedChunkColumnData = true;
+	PROFILE_SCOPE("Build chunk blocks");
 
-	for (int x = 0; x < CHUNK_SIZE; x++)
+	this->generator = &generator;
+	chunkColumnData = generator.loadChunkColumnData(position.x, position.z);
+
+	// Chunks fully above or below the surface skip per-block work
+	uniform = generator.classifyUniformChunk(position.y, chunkColumnData, uniformBlock);
+	if (uniform)
 	{
-		for (int z = 0; z < CHUNK_SIZE; z++)
-		{
-			const int globalHeight = heightMap[z + x * CHUNK_SIZE];
+		return;
+	}
 
-			for (int y = 0; y < CHUNK_SIZE; y++)
-			{
-				int worldY = position.y * CHUNK_SIZE + y;
-				if (worldY < globalHeight)
-				{
-					blocks[getIndex(x, y, z)] = Block::Solid;
-				}
-				else
-				{
-					blocks[getIndex(x, y, z)] = Block::Air;
-				}
-			}
-		}
+	generator.generateChunkBlocks(position.x, position.y, position.z, chunkColumnData, blocks);
+}
+
+void Chunk::setStoredBlocks(bool isUniform, Block block, const Block* storedBlocks)
+{
+	uniform = isUniform;
+	uniformBlock = block;
+	if (!uniform)
+	{
+		std::copy(storedBlocks, storedBlocks + CHUNK_VOLUME, blocks);
 	}
+	modified = true;
 }
 
 void Chunk::buildMesh()
 {
-	static thread_local std::vector<BlockFaceInstance> mesh;
-	assert(mesh.empty());
-	mesh.clear();
+	static thread_local std::vector<BlockFaceInstance> faces;
+	faces.clear();
+	buildMeshData(faces);
+
+	// Buffers are created on the first upload, so chunks can be generated without an OpenGL context
+	if (!mesh)
+	{
+		mesh = std::make_unique<ChunkMesh>();
+	}
+	mesh->upload(faces);
+	faces.clear();
+}
+
+void Chunk::buildMeshData(std::vector<BlockFaceInstance>& faces) const
+{
+	// Uniform air has no faces, uniform solid can only have faces on its border
+	const bool skipMesh = uniform && uniformBlock == Block::Air;
+	const bool borderOnly = uniform && uniformBlock != Block::Air;
 
 	// Collect visible faces
-	for (int x = 0; x < CHUNK_SIZE; x++)
+	for (int x = 0; x < CHUNK_SIZE && !skipMesh; x++)
 	{
 		for (int y = 0; y < CHUNK_SIZE; y++)
 		{
 			for (int z = 0; z < CHUNK_SIZE; z++)
 			{
+				if (borderOnly &&
+					x > 0 && x < CHUNK_SIZE - 1 &&
+					y > 0 && y < CHUNK_SIZE - 1 &&
+					z > 0 && z < CHUNK_SIZE - 1)
+				{
+					continue;
+				}
+
 				Block block = getBlock_inBoundaries(x, y, z);
 				if (block == Block::Air)
 				{
 					continue;
 				}
 
+				// Faces take the light of the air block in front of them
 				// -X
 				if (getBlock_checkNeighbors(x - 1, y, z) == Block::Air)
 				{
-					mesh.emplace_back(x, y, z, 0);
+					faces.emplace_back(x, y, z, 0, block, getLight_checkNeighbors(x - 1, y, z));
 				}
 				// +X
 				if (getBlock_checkNeighbors(x + 1, y, z) == Block::Air)
 				{
-					mesh.emplace_back(x, y, z, 1);
+					faces.emplace_back(x, y, z, 1, block, getLight_checkNeighbors(x + 1, y, z));
 				}
 				// -Y
 				if (getBlock_checkNeighbors(x, y - 1, z) == Block::Air)
 				{
-					mesh.emplace_back(x, y, z, 2);
+					faces.emplace_back(x, y, z, 2, block, getLight_checkNeighbors(x, y - 1, z));
 				}
 				// +Y
 				if (getBlock_checkNeighbors(x, y + 1, z) == Block::Air)
 				{
-					mesh.emplace_back(x, y, z, 3);
+					faces.emplace_back(x, y, z, 3, block, getLight_checkNeighbors(x, y + 1, z));
 				}
 				// -Z
 				if (getBlock_checkNeighbors(x, y, z - 1) == Block::Air)
 				{
-					mesh.emplace_back(x, y, z, 4);
+					faces.emplace_back(x, y, z, 4, block, getLight_checkNeighbors(x, y, z - 1));
 				}
 				// +Z
 				if (getBlock_checkNeighbors(x, y, z + 1) == Block::Air)
 				{
-					mesh.emplace_back(x, y, z, 5);
+					faces.emplace_back(x, y, z, 5, block, getLight_checkNeighbors(x, y, z + 1));
 				}
 			}
 		}
 	}
-
-	// Upload to GPU
-	{
-		// TODO: Maybe have a single VBO/VAO for all chunks, since they use the same vertices? If possible, I dunno.
-		
-		// TODO: Maybe have a pool for instance buffers? Chunk should ask for the minimum sized buffer that fits his needs.
-		// If there's none, it gets closest one and changes its size.
-
-		// Instance buffer
-		faceCount = mesh.size();
-
-		glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
-		if (faceCount > faceCapacity)
-		{
-			faceCapacity = faceCount;
-			glBufferData(GL_ARRAY_BUFFER, faceCount * sizeof(BlockFaceInstance), mesh.data(), GL_STATIC_DRAW);
-		}
-		else
-		{
-			glBufferSubData(GL_ARRAY_BUFFER, 0, faceCount * sizeof(BlockFaceInstance), mesh.data());
-		}
-
-		mesh.clear();
-	}
 }
 
 void Chunk::render() const
 {
-	if (faceCount == 0) return;
-	glBindVertexArray(vao);
-	glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, 4, faceCount);
+	if (mesh)
+	{
+		mesh->render();
+	}
 }
 
 // Function doesn't check for bounsaries, it trusts the caller. On debug mode, it asserts.
@@ -285,7 +235,7 @@ Block Chunk::getBlock_inBoundaries(int x, int y, int z) const
 	assert(x >= 0 && x < CHUNK_SIZE);
 	assert(y >= 0 && y < CHUNK_SIZE);
 	assert(z >= 0 && z < CHUNK_SIZE);
-	return blocks[getIndex(x, y, z)];
+	return uniform ? uniformBlock : blocks[getIndex(x, y, z)];
 }
 
 // Function checks neighbors, if out of boundaries. Neighbours are considered Air for now.
@@ -315,7 +265,56 @@ Block Chunk::getBlock_checkNeighbors(int x, int y, int z) const
 		}
 	}
 
-	return blocks[getIndex(x, y, z)];
+	return uniform ? uniformBlock : blocks[getIndex(x, y, z)];
+}
+
+// Uniform chunks are expanded into the 'blocks' array on the first differing write
+void Chunk::setBlock_inBoundaries(int x, int y, int z, Block block)
+{
+	assert(x >= 0 && x < CHUNK_SIZE);
+	assert(y >= 0 && y < CHUNK_SIZE);
+	assert(z >= 0 && z < CHUNK_SIZE);
+
+	if (uniform)
+	{
+		if (block == uniformBlock)
+		{
+			return;
+		}
+
+		std::fill(blocks, blocks + CHUNK_VOLUME, uniformBlock);
+		uniform = false;
+	}
+
+	blocks[getIndex(x, y, z)] = block;
+}
+
+// Light of unlit or missing neighbours is full, they get remeshed once lit
+uint8_t Chunk::getLight_checkNeighbors(int x, int y, int z) const
+{
+	const Chunk* chunk = this;
+
+	int nx = x & CHUNK_UPPER_BITS_MASK;
+	int ny = y & CHUNK_UPPER_BITS_MASK;
+	int nz = z & CHUNK_UPPER_BITS_MASK;
+
+	if (nx != 0 || ny != 0 || nz != 0)
+	{
+		chunk = nullptr;
+		if (nx < 0) chunk = neighbors[0]; // -X
+		else if (nx > 0) chunk = neighbors[1]; // +X
+		else if (ny < 0) chunk = neighbors[2]; // -Y
+		else if (ny > 0) chunk = neighbors[3]; // +Y
+		else if (nz < 0) chunk = neighbors[4]; // -Z
+		else if (nz > 0) chunk = neighbors[5]; // +Z
+	}
+
+	if (!chunk || chunk->getState() == State::NeedsBlocks || chunk->getState() == State::BuildingBlocks)
+	{
+		return 15;
+	}
+
+	return chunk->light[getIndex(x & CHUNK_LOWER_BITS_MASK, y & CHUNK_LOWER_BITS_MASK, z & CHUNK_LOWER_BITS_MASK)];
 }
 
 int Chunk::getX() const
@@ -348,14 +347,40 @@ void Chunk::setState(State newState)
 	state.store(newState, std::memory_order_release);
 }
 
+uint64_t Chunk::hashContents() const
+{
+	// FNV-1a over blocks and light, uniform chunks hash like their expanded array
+	uint64_t hash = 14695981039346656037ull;
+	auto mix = [&hash](uint8_t value)
+		{
+			hash ^= value;
+			hash *= 1099511628211ull;
+		};
+
+	for (int i = 0; i < CHUNK_VOLUME; i++)
+	{
+		mix(static_cast<uint8_t>(uniform ? uniformBlock : blocks[i]));
+	}
+	for (int i = 0; i < CHUNK_VOLUME; i++)
+	{
+		mix(light[i]);
+	}
+	return hash;
+}
+
+bool Chunk::isUniform() const
+{
+	return uniform;
+}
+
 size_t Chunk::getFaceCount() const
 {
-	return faceCount;
+	return mesh ? mesh->getFaceCount() : 0;
 }
 
 size_t Chunk::getFaceCapacity() const
 {
-	return faceCapacity;
+	return mesh ? mesh->getFaceCapacity() : 0;
 }
 
 //============================================================================
\ No newline at end of file
@@ -4,9 +4,14 @@
 
 #include "Int3.h"
 
-#include <glad/glad.h>
-
 #include <atomic>
+#include <memory>
+#include <vector>
+
+struct ChunkColumnData;
+struct BlockFaceInstance;
+class TerrainGenerator;
+class ChunkMesh;
 
 // TODO: Maybe 'blocks' should be a pointer to a dynamically allocated array, so it can be moved without copying?
 class Chunk
@@ -15,7 +20,7 @@ public:
 	enum class State
 	{
 		NeedsBlocks,      // Just created needs block generation
-		BuildingBlocks,   // Currently building blocks in background
+		BuildingBlocks,   // Going through the generation stages
 		NeedsMesh,        // Blocks ready, needs mesh generation
 		Ready             // Mesh ready, can render
 	};
@@ -23,11 +28,25 @@ private:
 	Int3 position; // Chunk coordinates in chunk space
 	Block blocks[CHUNK_VOLUME];
 
-	GLuint vao, vbo, instanceVBO; // Buffers
-	size_t faceCount;
-	size_t faceCapacity;
+	std::unique_ptr<ChunkMesh> mesh; // Created by the first buildMesh, null in headless worlds
+
+	TerrainGenerator* generator; // Owner of chunkColumnData
+	const ChunkColumnData* chunkColumnData; // Held from buildBlocks until destroy
+
+	// Chunk made of a single block type, 'blocks' isn't filled
+	bool uniform;
+	Block uniformBlock;
+
+	uint8_t light[CHUNK_VOLUME]; // Sky light 0-15, filled by the Light stage
 
-	bool loadedChunkColumnData;
+	// Generation pipeline, main thread only
+	int generationStage; // Number of finished stages
+	bool generationLocked; // Part of a running stage task's region
+	bool relightPending; // Finished chunk whose Light stage runs again, it stays finished meanwhile
+
+	// Persistence, main thread only
+	bool modified; // Blocks differ from generated output, set by edits and stored chunks
+	bool unsaved; // Edited since the last save
 
 	std::atomic<State> state;
 
@@ -48,13 +67,21 @@ public:
 	void init(int x, int y, int z, Chunk** neighbors);
 	void destroy();
 
-	void buildBlocks();
-	void buildMesh();
+	void buildBlocks(TerrainGenerator& generator);
+	void setStoredBlocks(bool isUniform, Block block, const Block* storedBlocks); // Replaces generated blocks with saved ones
+	void buildMeshData(std::vector<BlockFaceInstance>& faces) const; // Visible faces, no OpenGL calls
+	void buildMesh(); // Builds and uploads, main thread only
 
 	void render() const;
 
 	Block getBlock_inBoundaries(int x, int y, int z) const;
 	Block getBlock_checkNeighbors(int x, int y, int z) const;
+	void setBlock_inBoundaries(int x, int y, int z, Block block);
+
+	uint8_t getLight_checkNeighbors(int x, int y, int z) const;
+	uint8_t* getLightData() { return light; }
+
+	const ChunkColumnData* getChunkColumnData() const { return chunkColumnData; }
 
 	int getX() const;
 	int getY() const;
@@ -65,6 +92,23 @@ public:
 	State getState() const;
 	void setState(State newState);
 
+	bool isUniform() const;
+	Block getUniformBlock() const { return uniformBlock; }
+	const Block* getBlockData() const { return blocks; } // Not filled for uniform chunks
+	uint64_t hashContents() const; // Blocks and light, for reproducibility checks
+
+	int getGenerationStage() const { return generationStage; }
+	void setGenerationStage(int stage) { generationStage = stage; }
+	bool isGenerationLocked() const { return generationLocked; }
+	void setGenerationLocked(bool locked) { generationLocked = locked; }
+	bool isRelightPending() const { return relightPending; }
+	void setRelightPending(bool pending) { relightPending = pending; }
+
+	bool isModified() const { return modified; }
+	bool isUnsaved() const { return unsaved; }
+	void markEdited() { modified = true; unsaved = true; }
+	void markSaved() { unsaved = false; }
+
 	// Debug
 	size_t getFaceCount() const;
 	size_t getFaceCapacity() const;
@@ -0,0 +1,97 @@
+#include "ChunkRegion.h"
+
+#include "Chunk.h"
+
+ChunkRegion::ChunkRegion() :
+	radius(0)
+{
+	for (Chunk*& chunk : chunks)
+	{
+		chunk = nullptr;
+	}
+}
+
+void ChunkRegion::reset(Chunk* center, int radius)
+{
+	this->radius = radius;
+	for (Chunk*& chunk : chunks)
+	{
+		chunk = nullptr;
+	}
+	chunks[13] = center;
+}
+
+bool ChunkRegion::gather(Chunk* center, int radius)
+{
+	reset(center, radius);
+
+	if (radius == 0)
+	{
+		return true;
+	}
+
+	// Walk the face neighbour links, x then y then z
+	for (int dx = -1; dx <= 1; dx++)
+	{
+		Chunk* chunkX = dx == 0 ? center : center->neighbors[dx < 0 ? 0 : 1];
+		if (!chunkX)
+		{
+			return false;
+		}
+
+		for (int dy = -1; dy <= 1; dy++)
+		{
+			Chunk* chunkY = dy == 0 ? chunkX : chunkX->neighbors[dy < 0 ? 2 : 3];
+			if (!chunkY)
+			{
+				return false;
+			}
+
+			for (int dz = -1; dz <= 1; dz++)
+			{
+				Chunk* chunkZ = dz == 0 ? chunkY : chunkY->neighbors[dz < 0 ? 4 : 5];
+				if (!chunkZ)
+				{
+					return false;
+				}
+				chunks[getSlot(dx, dy, dz)] = chunkZ;
+			}
+		}
+	}
+	return true;
+}
+
+Block ChunkRegion::getBlock(int x, int y, int z) const
+{
+	int dx = (x & CHUNK_UPPER_BITS_MASK) / CHUNK_SIZE;
+	int dy = (y & CHUNK_UPPER_BITS_MASK) / CHUNK_SIZE;
+	int dz = (z & CHUNK_UPPER_BITS_MASK) / CHUNK_SIZE;
+	if (dx < -radius || dx > radius || dy < -radius || dy > radius || dz < -radius || dz > radius)
+	{
+		return Block::Air;
+	}
+
+	const Chunk* chunk = chunks[getSlot(dx, dy, dz)];
+	if (!chunk)
+	{
+		return Block::Air;
+	}
+	return chunk->getBlock_inBoundaries(x & CHUNK_LOWER_BITS_MASK, y & CHUNK_LOWER_BITS_MASK, z & CHUNK_LOWER_BITS_MASK);
+}
+
+void ChunkRegion::setBlock(int x, int y, int z, Block block)
+{
+	int dx = (x & CHUNK_UPPER_BITS_MASK) / CHUNK_SIZE;
+	int dy = (y & CHUNK_UPPER_BITS_MASK) / CHUNK_SIZE;
+	int dz = (z & CHUNK_UPPER_BITS_MASK) / CHUNK_SIZE;
+	if (dx < -radius || dx > radius || dy < -radius || dy > radius || dz < -radius || dz > radius)
+	{
+		return;
+	}
+
+	Chunk* chunk = chunks[getSlot(dx, dy, dz)];
+	if (chunk)
+	{
+		chunk->setBlock_inBoundaries(x & CHUNK_LOWER_BITS_MASK, y & CHUNK_LOWER_BITS_MASK, z & CHUNK_LOWER_BITS_MASK, block);
+	}
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include "Block.h"
+
+class Chunk;
+
+// Chunk and its neighbours within a radius of 0 or 1, handed to generation stages.
+// Coordinates are relative to the center chunk's origin, so radius 1 covers [-16, 31].
+class ChunkRegion
+{
+	Chunk* chunks[27];
+	int radius;
+
+	static int getSlot(int dx, int dy, int dz) { return ((dx + 1) * 3 + (dy + 1)) * 3 + (dz + 1); }
+public:
+	ChunkRegion();
+
+	// Main thread. Fails if a chunk inside the radius isn't loaded.
+	bool gather(Chunk* center, int radius);
+
+	// Partial region for chunks outside the world, slots left empty read as air
+	void reset(Chunk* center, int radius);
+	void setChunk(int dx, int dy, int dz, Chunk* chunk) { chunks[getSlot(dx, dy, dz)] = chunk; }
+
+	Chunk* getCenter() const { return chunks[13]; }
+	Chunk* getChunk(int dx, int dy, int dz) const { return chunks[getSlot(dx, dy, dz)]; }
+	int getRadius() const { return radius; }
+
+	template<typename Func>
+	void forEachChunk(Func func) const;
+
+	// Outside the region or in an empty slot reads as air, writes there are dropped
+	Block getBlock(int x, int y, int z) const;
+	void setBlock(int x, int y, int z, Block block);
+};
+
+template<typename Func>
+inline void ChunkRegion::forEachChunk(Func func) const
+{
+	for (Chunk* chunk : chunks)
+	{
+		if (chunk)
+		{
+			func(chunk);
+		}
+	}
+}
@@ -0,0 +1,196 @@
+#include "ColumnDiskCache.h"
+
+#include "TerrainGenerator.h"
+#include "Profiler.h"
+
+#include <iostream>
+#include <cstring>
+#include <cstddef>
+#include <climits>
+#include <type_traits>
+
+static_assert(std::is_trivially_copyable<Biome>::value && sizeof(Biome) == 1, "Biome is stored as one byte");
+
+static const char CACHE_MAGIC[8] = { 'V', 'O', 'X', 'C', 'O', 'L', 'S', '\0' };
+
+ColumnDiskCache::ColumnDiskCache() :
+	records(nullptr), bucketCount(0), fingerprint(0), hitCount(0), missCount(0), evictionCounter(0)
+{
+	static_assert(sizeof(FileHeader) == 64, "Header keeps records cache line aligned");
+}
+
+bool ColumnDiskCache::open(const std::string& path, size_t capacity)
+{
+	close();
+
+	bucketCount = 1;
+	while (bucketCount * BUCKET_SLOTS < capacity)
+	{
+		bucketCount <<= 1;
+	}
+
+	size_t fileSize = sizeof(FileHeader) + bucketCount * BUCKET_SLOTS * sizeof(Record);
+	if (!file.open(path, fileSize))
+	{
+		std::cerr << "ColumnDiskCache: Running without disk cache." << std::endl;
+		bucketCount = 0;
+		return false;
+	}
+
+	FileHeader* header = reinterpret_cast<FileHeader*>(file.getData());
+	records = reinterpret_cast<Record*>(file.getData() + sizeof(FileHeader));
+
+	bool valid = memcmp(header->magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) == 0
+		&& header->formatVersion == FORMAT_VERSION
+		&& header->recordSize == sizeof(Record)
+		&& header->bucketCount == bucketCount;
+	if (!valid)
+	{
+		// New file, or one written with another layout
+		memset(file.getData(), 0, fileSize);
+		memcpy(header->magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+		header->formatVersion = FORMAT_VERSION;
+		header->recordSize = sizeof(Record);
+		header->bucketCount = bucketCount;
+	}
+
+	hitCount.store(0, std::memory_order_relaxed);
+	missCount.store(0, std::memory_order_relaxed);
+	return true;
+}
+
+void ColumnDiskCache::close()
+{
+	file.close();
+	records = nullptr;
+	bucketCount = 0;
+}
+
+void ColumnDiskCache::flush()
+{
+	file.flush();
+}
+
+size_t ColumnDiskCache::getBucket(int x, int z) const
+{
+	uint32_t hash = static_cast<uint32_t>(x) * 0x9E3779B1u ^ static_cast<uint32_t>(z) * 0x85EBCA77u;
+	hash ^= hash >> 15;
+	hash *= 0x2C1B3C6Du;
+	hash ^= hash >> 12;
+	return hash & (bucketCount - 1);
+}
+
+uint32_t ColumnDiskCache::computeChecksum(const Record& record)
+{
+	// FNV-1a over the payload
+	const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&record.minHeight);
+	size_t size = sizeof(Record) - offsetof(Record, minHeight);
+
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash = (hash ^ bytes[i]) * 16777619u;
+	}
+	return hash;
+}
+
+bool ColumnDiskCache::load(ChunkColumnData& column)
+{
+	if (!records)
+	{
+		return false;
+	}
+
+	PROFILE_SCOPE("Column disk cache load");
+
+	size_t bucket = getBucket(column.X, column.Z);
+	std::lock_guard<std::mutex> lock(locks[bucket & (LOCK_COUNT - 1)]);
+
+	const Record* slots = records + bucket * BUCKET_SLOTS;
+	for (size_t i = 0; i < BUCKET_SLOTS; i++)
+	{
+		const Record& record = slots[i];
+		if (!record.valid || record.x != column.X || record.z != column.Z || record.fingerprint != fingerprint)
+		{
+			continue;
+		}
+
+		if (record.checksum != computeChecksum(record))
+		{
+			break;
+		}
+
+		column.minHeight = record.minHeight;
+		column.maxHeight = record.maxHeight;
+		for (int j = 0; j < CHUNK_AREA; j++)
+		{
+			column.heightMap[j] = record.heightMap[j];
+		}
+		memcpy(column.biomeMap, record.biomeMap, sizeof(record.biomeMap));
+
+		hitCount.fetch_add(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	missCount.fetch_add(1, std::memory_order_relaxed);
+	return false;
+}
+
+void ColumnDiskCache::store(const ChunkColumnData& column)
+{
+	if (!records)
+	{
+		return;
+	}
+
+	// Heights are stored as 16 bit, extreme terrain settings just aren't cached
+	if (column.minHeight < SHRT_MIN || column.maxHeight > SHRT_MAX)
+	{
+		return;
+	}
+
+	PROFILE_SCOPE("Column disk cache store");
+
+	size_t bucket = getBucket(column.X, column.Z);
+	std::lock_guard<std::mutex> lock(locks[bucket & (LOCK_COUNT - 1)]);
+
+	// Same column first, then a free slot, then a record of another generator, otherwise evict
+	Record* slots = records + bucket * BUCKET_SLOTS;
+	Record* target = nullptr;
+	Record* freeSlot = nullptr;
+	Record* staleSlot = nullptr;
+	for (size_t i = 0; i < BUCKET_SLOTS; i++)
+	{
+		Record& record = slots[i];
+		if (!record.valid)
+		{
+			if (!freeSlot) freeSlot = &record;
+		}
+		else if (record.fingerprint != fingerprint)
+		{
+			if (!staleSlot) staleSlot = &record;
+		}
+		else if (record.x == column.X && record.z == column.Z)
+		{
+			target = &record;
+			break;
+		}
+	}
+	if (!target) target = freeSlot;
+	if (!target) target = staleSlot;
+	if (!target) target = &slots[evictionCounter.fetch_add(1, std::memory_order_relaxed) & (BUCKET_SLOTS - 1)];
+
+	target->valid = 0;
+	target->fingerprint = fingerprint;
+	target->x = column.X;
+	target->z = column.Z;
+	target->minHeight = static_cast<int16_t>(column.minHeight);
+	target->maxHeight = static_cast<int16_t>(column.maxHeight);
+	for (int i = 0; i < CHUNK_AREA; i++)
+	{
+		target->heightMap[i] = static_cast<int16_t>(column.heightMap[i]);
+	}
+	memcpy(target->biomeMap, column.biomeMap, sizeof(target->biomeMap));
+	target->checksum = computeChecksum(*target);
+	target->valid = 1;
+}
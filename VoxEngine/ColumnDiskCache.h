@@ -0,0 +1,78 @@
+#pragma once
+#include "Metrics.h"
+
+#include "MappedFile.h"
+
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+struct ChunkColumnData;
+
+// Memory mapped file of generated column products (height map, biome map, height bounds).
+// Records are keyed by column position and a generator fingerprint, so records of another seed or
+// generator version simply miss and get overwritten. Fixed size open addressing table, full buckets evict.
+class ColumnDiskCache
+{
+	static constexpr uint32_t FORMAT_VERSION = 1;
+	static constexpr size_t BUCKET_SLOTS = 8; // Slots probed per column
+	static constexpr size_t LOCK_COUNT = 64;
+
+	struct FileHeader
+	{
+		char magic[8];
+		uint32_t formatVersion;
+		uint32_t recordSize;
+		uint64_t bucketCount;
+		uint8_t padding[40];
+	};
+
+	struct Record
+	{
+		uint64_t fingerprint;
+		int32_t x, z;
+		uint32_t valid; // Cleared while the record is written
+		uint32_t checksum; // Over everything below, a torn write reads as a miss
+		int16_t minHeight, maxHeight;
+		int16_t heightMap[CHUNK_AREA];
+		uint8_t biomeMap[CHUNK_AREA];
+	};
+
+	MappedFile file;
+	Record* records;
+	size_t bucketCount; // Power of two
+	uint64_t fingerprint;
+
+	std::mutex locks[LOCK_COUNT]; // Striped by bucket
+	std::atomic<uint64_t> hitCount;
+	std::atomic<uint64_t> missCount;
+	std::atomic<uint32_t> evictionCounter;
+
+	size_t getBucket(int x, int z) const;
+	static uint32_t computeChecksum(const Record& record);
+public:
+	ColumnDiskCache();
+	~ColumnDiskCache() = default;
+
+	ColumnDiskCache(const ColumnDiskCache&) = delete;
+	ColumnDiskCache& operator=(const ColumnDiskCache&) = delete;
+	ColumnDiskCache(ColumnDiskCache&&) = delete;
+	ColumnDiskCache& operator=(ColumnDiskCache&&) = delete;
+
+	// Capacity in columns, rounded up to whole buckets. A file with another layout or capacity is cleared.
+	bool open(const std::string& path, size_t capacity);
+	void close();
+	bool isOpen() const { return file.isOpen(); }
+
+	// Records written with another fingerprint miss
+	void setFingerprint(uint64_t generatorFingerprint) { fingerprint = generatorFingerprint; }
+
+	// Thread safe. Load fills everything but X and Z, which select the record.
+	bool load(ChunkColumnData& column);
+	void store(const ChunkColumnData& column);
+	void flush();
+
+	uint64_t getHitCount() const { return hitCount.load(std::memory_order_relaxed); }
+	uint64_t getMissCount() const { return missCount.load(std::memory_order_relaxed); }
+};
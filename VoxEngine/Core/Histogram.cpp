@@ -0,0 +1,166 @@
+#include "Histogram.h"
+
+#include <algorithm>
+#include <cstring>
+
+//============================================================================
+// LogLinearHistogram
+
+static int getMostSignificantBit(uint64_t value)
+{
+	int bit = 0;
+	while (value >>= 1)
+	{
+		bit++;
+	}
+	return bit;
+}
+
+LogLinearHistogram::LogLinearHistogram()
+{
+	reset();
+}
+
+size_t LogLinearHistogram::getBucketIndex(uint64_t value)
+{
+	if (value < SUB_BUCKET_COUNT)
+	{
+		return static_cast<size_t>(value);
+	}
+
+	int magnitude = getMostSignificantBit(value);
+	if (magnitude > MAX_MAGNITUDE)
+	{
+		return BUCKET_COUNT - 1;
+	}
+	int shift = magnitude - SUB_BUCKET_BITS;
+
+	// Bits below the leading one select the linear sub bucket
+	uint64_t subBucket = (value >> shift) & (SUB_BUCKET_COUNT - 1);
+
+	return static_cast<size_t>(SUB_BUCKET_COUNT + shift * SUB_BUCKET_COUNT + subBucket);
+}
+
+uint64_t LogLinearHistogram::getBucketLowerBound(size_t index)
+{
+	if (index < SUB_BUCKET_COUNT)
+	{
+		return index;
+	}
+
+	size_t shift = (index - SUB_BUCKET_COUNT) / SUB_BUCKET_COUNT;
+	uint64_t subBucket = (index - SUB_BUCKET_COUNT) % SUB_BUCKET_COUNT;
+	return (SUB_BUCKET_COUNT + subBucket) << shift;
+}
+
+uint64_t LogLinearHistogram::getBucketUpperBound(size_t index)
+{
+	if (index < SUB_BUCKET_COUNT)
+	{
+		return index;
+	}
+
+	size_t shift = (index - SUB_BUCKET_COUNT) / SUB_BUCKET_COUNT;
+	return getBucketLowerBound(index) + (1ull << shift) - 1;
+}
+
+void LogLinearHistogram::record(uint64_t value)
+{
+	counts[getBucketIndex(value)]++;
+	totalCount++;
+}
+
+void LogLinearHistogram::add(const LogLinearHistogram& other)
+{
+	for (size_t i = 0; i < BUCKET_COUNT; i++)
+	{
+		counts[i] += other.counts[i];
+	}
+	totalCount += other.totalCount;
+}
+
+void LogLinearHistogram::reset()
+{
+	std::memset(counts, 0, sizeof(counts));
+	totalCount = 0;
+}
+
+uint64_t LogLinearHistogram::getValueAtPercentile(double percentile) const
+{
+	if (totalCount == 0)
+	{
+		return 0;
+	}
+
+	percentile = std::min(std::max(percentile, 0.0), 100.0);
+	uint64_t target = static_cast<uint64_t>(percentile / 100.0 * totalCount + 0.5);
+	target = std::min(std::max(target, (uint64_t)1), totalCount);
+
+	uint64_t accumulated = 0;
+	for (size_t i = 0; i < BUCKET_COUNT; i++)
+	{
+		accumulated += counts[i];
+		if (accumulated >= target)
+		{
+			// Midpoint of the bucket
+			return (getBucketLowerBound(i) + getBucketUpperBound(i)) / 2;
+		}
+	}
+	return getBucketUpperBound(BUCKET_COUNT - 1);
+}
+
+//============================================================================
+// RollingHistogram
+
+RollingHistogram::RollingHistogram() :
+	currentSlice(0)
+{
+}
+
+void RollingHistogram::record(uint64_t value)
+{
+	slices[currentSlice].record(value);
+}
+
+void RollingHistogram::advanceWindow()
+{
+	currentSlice = (currentSlice + 1) % WINDOW_SLICES;
+	slices[currentSlice].reset();
+}
+
+void RollingHistogram::reset()
+{
+	for (LogLinearHistogram& slice : slices)
+	{
+		slice.reset();
+	}
+	currentSlice = 0;
+}
+
+void RollingHistogram::getPercentiles(const double* percentiles, uint64_t* out, size_t count) const
+{
+	// Merging is cheap compared to keeping a running total, and only happens on report
+	static thread_local LogLinearHistogram merged;
+	merged.reset();
+	for (const LogLinearHistogram& slice : slices)
+	{
+		merged.add(slice);
+	}
+
+	for (size_t i = 0; i < count; i++)
+	{
+		out[i] = merged.getValueAtPercentile(percentiles[i]);
+	}
+}
+
+uint64_t RollingHistogram::getTotalCount() const
+{
+	uint64_t total = 0;
+	for (const LogLinearHistogram& slice : slices)
+	{
+		total += slice.getTotalCount();
+	}
+	return total;
+}
+
+//============================================================================
@@ -0,0 +1,50 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+// Fixed-memory log-linear histogram (HDR style). Values below SUB_BUCKET_COUNT are exact,
+// larger values keep SUB_BUCKET_BITS significant bits, so the relative error is below 1/32.
+class LogLinearHistogram
+{
+public:
+	static constexpr int SUB_BUCKET_BITS = 5;
+	static constexpr uint64_t SUB_BUCKET_COUNT = 1ull << SUB_BUCKET_BITS;
+	static constexpr int MAX_MAGNITUDE = 40; // Larger values are clamped
+	static constexpr size_t BUCKET_COUNT = SUB_BUCKET_COUNT * (MAX_MAGNITUDE - SUB_BUCKET_BITS + 2);
+private:
+	uint32_t counts[BUCKET_COUNT];
+	uint64_t totalCount;
+public:
+	LogLinearHistogram();
+
+	void record(uint64_t value);
+	void add(const LogLinearHistogram& other);
+	void reset();
+
+	uint64_t getTotalCount() const { return totalCount; }
+	uint64_t getValueAtPercentile(double percentile) const;
+
+	static size_t getBucketIndex(uint64_t value);
+	static uint64_t getBucketLowerBound(size_t index);
+	static uint64_t getBucketUpperBound(size_t index);
+};
+
+// Histogram over the last WINDOW_SLICES intervals. Advancing the window drops only the oldest interval.
+class RollingHistogram
+{
+public:
+	static constexpr int WINDOW_SLICES = 10;
+private:
+	LogLinearHistogram slices[WINDOW_SLICES];
+	int currentSlice;
+public:
+	RollingHistogram();
+
+	void record(uint64_t value);
+	void advanceWindow();
+	void reset();
+
+	// Fills 'out' with percentiles (0-100) of the whole window
+	void getPercentiles(const double* percentiles, uint64_t* out, size_t count) const;
+	uint64_t getTotalCount() const;
+};
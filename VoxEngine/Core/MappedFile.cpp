@@ -0,0 +1,151 @@
+#include "MappedFile.h"
+
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile() :
+	data(nullptr), size(0), fileHandle(INVALID_HANDLE_VALUE), mappingHandle(nullptr)
+{
+}
+
+bool MappedFile::open(const std::string& path, size_t fileSize)
+{
+	close();
+
+	fileHandle = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+		OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (fileHandle == INVALID_HANDLE_VALUE)
+	{
+		std::cerr << "MappedFile: Failed to open " << path << "." << std::endl;
+		return false;
+	}
+
+	LARGE_INTEGER largeSize;
+	largeSize.QuadPart = static_cast<LONGLONG>(fileSize);
+	mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READWRITE, largeSize.HighPart, largeSize.LowPart, nullptr);
+	if (!mappingHandle)
+	{
+		std::cerr << "MappedFile: Failed to map " << path << "." << std::endl;
+		close();
+		return false;
+	}
+
+	data = static_cast<uint8_t*>(MapViewOfFile(mappingHandle, FILE_MAP_ALL_ACCESS, 0, 0, fileSize));
+	if (!data)
+	{
+		std::cerr << "MappedFile: Failed to map view of " << path << "." << std::endl;
+		close();
+		return false;
+	}
+
+	size = fileSize;
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (data)
+	{
+		FlushViewOfFile(data, 0);
+		UnmapViewOfFile(data);
+		data = nullptr;
+	}
+	if (mappingHandle)
+	{
+		CloseHandle(mappingHandle);
+		mappingHandle = nullptr;
+	}
+	if (fileHandle != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(fileHandle);
+		fileHandle = INVALID_HANDLE_VALUE;
+	}
+	size = 0;
+}
+
+void MappedFile::flush()
+{
+	if (data)
+	{
+		FlushViewOfFile(data, 0);
+	}
+}
+
+#else
+
+MappedFile::MappedFile() :
+	data(nullptr), size(0), fileDescriptor(-1)
+{
+}
+
+bool MappedFile::open(const std::string& path, size_t fileSize)
+{
+	close();
+
+	fileDescriptor = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+	if (fileDescriptor < 0)
+	{
+		std::cerr << "MappedFile: Failed to open " << path << "." << std::endl;
+		return false;
+	}
+
+	if (ftruncate(fileDescriptor, static_cast<off_t>(fileSize)) != 0)
+	{
+		std::cerr << "MappedFile: Failed to resize " << path << "." << std::endl;
+		close();
+		return false;
+	}
+
+	void* mapping = mmap(nullptr, fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, fileDescriptor, 0);
+	if (mapping == MAP_FAILED)
+	{
+		std::cerr << "MappedFile: Failed to map " << path << "." << std::endl;
+		close();
+		return false;
+	}
+
+	data = static_cast<uint8_t*>(mapping);
+	size = fileSize;
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (data)
+	{
+		munmap(data, size);
+		data = nullptr;
+	}
+	if (fileDescriptor >= 0)
+	{
+		::close(fileDescriptor);
+		fileDescriptor = -1;
+	}
+	size = 0;
+}
+
+void MappedFile::flush()
+{
+	if (data)
+	{
+		msync(data, size, MS_ASYNC);
+	}
+}
+
+#endif
+
+MappedFile::~MappedFile()
+{
+	close();
+}
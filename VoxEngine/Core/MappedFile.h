@@ -0,0 +1,33 @@
+#pragma once
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// Read-write memory mapping of a whole file, created or resized on open
+class MappedFile
+{
+	uint8_t* data;
+	size_t size;
+#ifdef _WIN32
+	void* fileHandle;
+	void* mappingHandle;
+#else
+	int fileDescriptor;
+#endif
+public:
+	MappedFile();
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	MappedFile(MappedFile&&) = delete;
+	MappedFile& operator=(MappedFile&&) = delete;
+
+	bool open(const std::string& path, size_t fileSize);
+	void close();
+	void flush(); // Asynchronous write back of dirty pages
+
+	bool isOpen() const { return data != nullptr; }
+	uint8_t* getData() const { return data; }
+	size_t getSize() const { return size; }
+};
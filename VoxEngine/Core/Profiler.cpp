@@ -2,6 +2,9 @@
 #include <iostream>
 #include <iomanip>
 #include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <thread>
 
 double Profiler::ProfileData::getAverageTime() const
 {
@@ -24,33 +27,412 @@ void Profiler::ProfileData::reset()
     callCount = 0;
 }
 
+//============================================================================
+// ThreadEventBuffer
+
+Profiler::ThreadEventBuffer::ThreadEventBuffer(uint32_t threadIndex) :
+    writeIndex(0), readIndex(0), droppedEvents(0), threadIndex(threadIndex),
+    callNodeCount(0), firstRootNode(NO_NODE), currentNode(NO_NODE)
+{
+}
+
+void Profiler::ThreadEventBuffer::push(const ProfileEvent& event)
+{
+    size_t write = writeIndex.load(std::memory_order_relaxed);
+    size_t read = readIndex.load(std::memory_order_acquire);
+
+    // Buffer is full, main thread hasn't collected events for too long
+    if (write - read >= CAPACITY)
+    {
+        droppedEvents.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    events[write & MASK] = event;
+    writeIndex.store(write + 1, std::memory_order_release);
+}
+
+uint64_t Profiler::ThreadEventBuffer::takeDroppedEvents()
+{
+    return droppedEvents.exchange(0, std::memory_order_relaxed);
+}
+
+uint32_t Profiler::ThreadEventBuffer::enterScope(uint32_t tagId)
+{
+    uint32_t& firstChild = (currentNode == NO_NODE) ? firstRootNode : callNodes[currentNode].firstChild;
+
+    // Scopes have only a few distinct children, so walking siblings is fast
+    uint32_t node = firstChild;
+    while (node != NO_NODE && callNodes[node].tagId != tagId)
+    {
+        node = callNodes[node].nextSibling;
+    }
+
+    if (node == NO_NODE)
+    {
+        // Too many call paths, attribute nested scopes to the parent
+        if (callNodeCount == MAX_CALL_NODES)
+        {
+            return NO_NODE;
+        }
+
+        node = callNodeCount++;
+        callNodes[node] = { tagId, currentNode, NO_NODE, firstChild };
+        firstChild = node;
+    }
+
+    currentNode = node;
+    return node;
+}
+
+//============================================================================
+// ProfileTag
+
+ProfileTag::ProfileTag(const char* name) :
+    name(name), id(Profiler::registerTag(name))
+{
+}
+
+//============================================================================
+// Profiler
+
 // Static member definitions
-std::unordered_map<std::string, Profiler::ProfileData> Profiler::profileData;
-std::chrono::high_resolution_clock::time_point Profiler::frameStartTime;
+constexpr uint32_t Profiler::NO_NODE;
+std::mutex Profiler::tagMutex;
+std::vector<const char*> Profiler::tagNames;
+std::mutex Profiler::bufferMutex;
+std::vector<std::unique_ptr<Profiler::ThreadEventBuffer>> Profiler::threadBuffers;
+std::vector<Profiler::ProfileData> Profiler::profileData;
+std::vector<std::unique_ptr<RollingHistogram>> Profiler::histograms;
+std::vector<Profiler::CallTreeNode> Profiler::callTree;
+std::vector<uint32_t> Profiler::callTreeRoots;
+uint32_t Profiler::frameNode = Profiler::NO_NODE;
+uint32_t Profiler::frameParentNode = Profiler::NO_NODE;
+Profiler::Clock::time_point Profiler::frameStartTime;
 double Profiler::lastFrameTime = 0.0;
+uint64_t Profiler::droppedEvents = 0;
+std::vector<Profiler::CapturedEvent> Profiler::frameEvents;
+std::vector<Profiler::CounterSample> Profiler::frameCounters;
+std::vector<Profiler::CapturedEvent> Profiler::capturedEvents;
+int Profiler::captureFramesRemaining = 0;
+int Profiler::captureCount = 0;
+double Profiler::autoCaptureThreshold = 0.0;
+int Profiler::autoCaptureFrames = 0;
+std::deque<Profiler::HitchFrame> Profiler::hitchFrames;
+size_t Profiler::hitchEventCount = 0;
+double Profiler::hitchThreshold = 0.0;
+double Profiler::hitchWindow = 0.0;
+int64_t Profiler::lastHitchTicks = 0;
+int Profiler::hitchCount = 0;
+std::mutex Profiler::hitchWriteMutex;
+std::condition_variable Profiler::hitchWriteCondition;
+std::vector<Profiler::HitchWrite> Profiler::hitchWrites;
+bool Profiler::hitchWriterStop = false;
+std::thread Profiler::hitchWriterThread;
+
+// Destroyed before the members above, in case an exit path doesn't call shutdown()
+static struct HitchWriterGuard
+{
+    ~HitchWriterGuard() { Profiler::shutdown(); }
+} hitchWriterGuard;
 
-void Profiler::beginFrame()
+Profiler::ThreadEventBuffer& Profiler::getThreadBuffer()
+{
+    static thread_local ThreadEventBuffer* buffer = nullptr;
+    if (!buffer)
+    {
+        // Buffers are never freed, so the collecting thread can't read a dead one
+        std::lock_guard<std::mutex> lock(bufferMutex);
+        threadBuffers.push_back(std::make_unique<ThreadEventBuffer>(static_cast<uint32_t>(threadBuffers.size())));
+        buffer = threadBuffers.back().get();
+    }
+    return *buffer;
+}
+
+const ProfileTag& Profiler::getFrameTag()
 {
-    frameStartTime = std::chrono::high_resolution_clock::now();
+    static const ProfileTag frameTag("Frame Total");
+    return frameTag;
 }
 
-void Profiler::endFrame()
+void Profiler::collectEvents()
 {
-    auto frameEndTime = std::chrono::high_resolution_clock::now();
-    lastFrameTime = std::chrono::duration<double, std::milli>(frameEndTime - frameStartTime).count();
+    {
+        std::lock_guard<std::mutex> lock(tagMutex);
+        ensureTagStorage(tagNames.size());
+    }
 
-    // Add frame time to profile data
-    auto it = profileData.find("Frame Total");
-    if (it != profileData.end())
+    frameEvents.clear();
+
+    std::lock_guard<std::mutex> lock(bufferMutex);
+    for (const auto& buffer : threadBuffers)
+    {
+        ThreadEventBuffer* bufferPtr = buffer.get();
+        uint32_t threadIndex = buffer->getThreadIndex();
+        buffer->consume([bufferPtr, threadIndex](const ProfileEvent& event)
+            {
+                // Tag may have been registered after the resize above
+                ensureTagStorage(event.tagId + 1);
+
+                Clock::duration duration(event.endTicks - event.startTicks);
+                profileData[event.tagId].addSample(std::chrono::duration<double, std::milli>(duration).count());
+                histograms[event.tagId]->record(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+
+                uint32_t node = mapCallNode(*bufferPtr, event.callNode);
+                if (node != NO_NODE)
+                {
+                    CallTreeNode& treeNode = callTree[node];
+                    double time = std::chrono::duration<double, std::milli>(duration).count();
+                    treeNode.totalTime += time;
+                    treeNode.maxTime = std::max(treeNode.maxTime, time);
+                    treeNode.callCount++;
+                }
+
+                frameEvents.push_back({ event.tagId, threadIndex, event.startTicks, event.endTicks });
+            });
+        droppedEvents += buffer->takeDroppedEvents();
+    }
+}
+
+void Profiler::ensureTagStorage(size_t tagCount)
+{
+    if (profileData.size() >= tagCount)
+    {
+        return;
+    }
+
+    profileData.resize(tagCount);
+    while (histograms.size() < tagCount)
+    {
+        histograms.push_back(std::make_unique<RollingHistogram>());
+    }
+}
+
+uint32_t Profiler::mapCallNode(ThreadEventBuffer& buffer, uint32_t node)
+{
+    if (node == NO_NODE)
+    {
+        return NO_NODE;
+    }
+
+    std::vector<uint32_t>& globalNodes = buffer.globalCallNodes;
+    if (node < globalNodes.size() && globalNodes[node] != NO_NODE)
+    {
+        return globalNodes[node];
+    }
+
+    const ThreadEventBuffer::CallNode& callNode = buffer.getCallNode(node);
+    uint32_t parent = mapCallNode(buffer, callNode.parent);
+
+    // Same call path on different threads shares a node
+    std::vector<uint32_t>& siblings = (parent == NO_NODE) ? callTreeRoots : callTree[parent].children;
+    uint32_t globalNode = NO_NODE;
+    for (uint32_t sibling : siblings)
+    {
+        if (callTree[sibling].tagId == callNode.tagId)
+        {
+            globalNode = sibling;
+            break;
+        }
+    }
+
+    if (globalNode == NO_NODE)
+    {
+        globalNode = static_cast<uint32_t>(callTree.size());
+        CallTreeNode treeNode;
+        treeNode.tagId = callNode.tagId;
+        treeNode.parent = parent;
+        callTree.push_back(std::move(treeNode));
+
+        // Vector may have been reallocated, don't use 'siblings'
+        if (parent == NO_NODE)
+        {
+            callTreeRoots.push_back(globalNode);
+        }
+        else
+        {
+            callTree[parent].children.push_back(globalNode);
+        }
+    }
+
+    if (node >= globalNodes.size())
+    {
+        globalNodes.resize(node + 1, NO_NODE);
+    }
+    globalNodes[node] = globalNode;
+    return globalNode;
+}
+
+void Profiler::updateCapture()
+{
+    // Slow frame starts a capture that includes the frame itself
+    if (!isCapturing() && autoCaptureThreshold > 0.0 && lastFrameTime > autoCaptureThreshold)
+    {
+        std::cout << "Profiler: Slow frame (" << lastFrameTime << " ms), capturing timeline." << std::endl;
+        captureFramesRemaining = autoCaptureFrames;
+    }
+
+    if (!isCapturing())
+    {
+        return;
+    }
+
+    capturedEvents.insert(capturedEvents.end(), frameEvents.begin(), frameEvents.end());
+
+    captureFramesRemaining--;
+    if (captureFramesRemaining == 0)
+    {
+        std::string path = "profiler_capture_" + std::to_string(captureCount++) + ".json";
+        if (writeChromeTrace(path, capturedEvents))
+        {
+            std::cout << "Profiler: Timeline capture written to " << path << std::endl;
+        }
+        else
+        {
+            std::cerr << "Profiler: Failed to write " << path << std::endl;
+        }
+        capturedEvents.clear();
+    }
+}
+
+void Profiler::updateHitchCapture(int64_t frameStartTicks, int64_t frameEndTicks)
+{
+    if (hitchThreshold <= 0.0)
+    {
+        return;
+    }
+
+    int64_t windowTicks = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(hitchWindow)).count();
+    size_t eventCount = std::min(frameEvents.size(), MAX_HITCH_FRAME_EVENTS);
+
+    // Drop frames that left the window, so the buffer follows the frame rate, and the oldest frames past the event budget.
+    // The last dropped frame's vectors are reused.
+    HitchFrame frame;
+    while (!hitchFrames.empty() && (frameEndTicks - hitchFrames.front().startTicks > windowTicks ||
+        hitchEventCount + eventCount > MAX_HITCH_EVENTS))
+    {
+        hitchEventCount -= hitchFrames.front().events.size();
+        frame = std::move(hitchFrames.front());
+        hitchFrames.pop_front();
+    }
+
+    // Don't keep the capacity of a much busier frame around
+    if (frame.events.capacity() > eventCount * 2 + 256)
+    {
+        std::vector<CapturedEvent>().swap(frame.events);
+    }
+    if (frame.counters.capacity() > frameCounters.size() * 2 + 64)
+    {
+        std::vector<CounterSample>().swap(frame.counters);
+    }
+
+    frame.startTicks = frameStartTicks;
+    frame.endTicks = frameEndTicks;
+    frame.events.assign(frameEvents.begin(), frameEvents.begin() + eventCount);
+    frame.counters.assign(frameCounters.begin(), frameCounters.end());
+    hitchFrames.push_back(std::move(frame));
+    hitchEventCount += eventCount;
+
+    if (lastFrameTime <= hitchThreshold)
+    {
+        return;
+    }
+
+    // Window already covers hitches that follow shortly after
+    if (lastHitchTicks != 0 && frameEndTicks - lastHitchTicks < windowTicks)
+    {
+        return;
+    }
+    lastHitchTicks = frameEndTicks;
+
+    std::vector<CapturedEvent> events;
+    std::vector<CounterSample> counters;
+    events.reserve(hitchEventCount);
+    for (const HitchFrame& recorded : hitchFrames)
+    {
+        events.insert(events.end(), recorded.events.begin(), recorded.events.end());
+        counters.insert(counters.end(), recorded.counters.begin(), recorded.counters.end());
+    }
+
+    std::string path = "hitch_" + std::to_string(hitchCount++) + ".json";
+    std::cout << "Profiler: Hitch (" << lastFrameTime << " ms), writing last " << hitchWindow << " s to " << path << std::endl;
+
+    // Writing takes a while, don't make the next frame slow too
+    {
+        std::lock_guard<std::mutex> lock(hitchWriteMutex);
+        hitchWrites.push_back({ path, std::move(events), std::move(counters) });
+        if (!hitchWriterThread.joinable())
+        {
+            hitchWriterStop = false;
+            hitchWriterThread = std::thread(&Profiler::hitchWriterThreadMain);
+        }
+    }
+    hitchWriteCondition.notify_one();
+}
+
+void Profiler::hitchWriterThreadMain()
+{
+    std::unique_lock<std::mutex> lock(hitchWriteMutex);
+    while (true)
     {
-        it->second.addSample(lastFrameTime);
+        hitchWriteCondition.wait(lock, []() { return hitchWriterStop || !hitchWrites.empty(); });
+        if (hitchWrites.empty())
+        {
+            break; // Stopping, everything queued is written
+        }
+
+        HitchWrite write = std::move(hitchWrites.front());
+        hitchWrites.erase(hitchWrites.begin());
+        lock.unlock();
+
+        if (!writeChromeTrace(write.path, write.events, write.counters))
+        {
+            std::cerr << "Profiler: Failed to write " << write.path << std::endl;
+        }
+
+        lock.lock();
     }
-    else
+}
+
+void Profiler::shutdown()
+{
     {
-        ProfileData data;
-        data.addSample(lastFrameTime);
-        profileData["Frame Total"] = data;
+        std::lock_guard<std::mutex> lock(hitchWriteMutex);
+        if (!hitchWriterThread.joinable())
+        {
+            return;
+        }
+        hitchWriterStop = true;
     }
+    hitchWriteCondition.notify_one();
+    hitchWriterThread.join();
+}
+
+// Scopes on the main thread between beginFrame and endFrame become children of "Frame Total"
+void Profiler::beginFrame()
+{
+    ThreadEventBuffer& buffer = getThreadBuffer();
+    frameParentNode = buffer.getCurrentNode();
+    frameNode = buffer.enterScope(getFrameTag().getId());
+
+    frameStartTime = Clock::now();
+}
+
+void Profiler::endFrame()
+{
+    auto frameEndTime = Clock::now();
+    lastFrameTime = std::chrono::duration<double, std::milli>(frameEndTime - frameStartTime).count();
+
+    // Add frame time to profile data
+    ThreadEventBuffer& buffer = getThreadBuffer();
+    buffer.push({ getFrameTag().getId(), frameNode, toTicks(frameStartTime), toTicks(frameEndTime) });
+    buffer.leaveScope(frameParentNode);
+
+    collectEvents();
+    updateCapture();
+    updateHitchCapture(toTicks(frameStartTime), toTicks(frameEndTime));
+
+    frameCounters.clear();
 }
 
 void Profiler::beginProfile(const std::string& name)
@@ -65,20 +447,57 @@ void Profiler::endProfile(const std::string& name)
     // For most use cases, prefer ScopedProfiler
 }
 
+uint32_t Profiler::registerTag(const char* name)
+{
+    std::lock_guard<std::mutex> lock(tagMutex);
+
+    // Same name at different call sites shares one entry
+    for (size_t i = 0; i < tagNames.size(); i++)
+    {
+        if (std::strcmp(tagNames[i], name) == 0)
+        {
+            return static_cast<uint32_t>(i);
+        }
+    }
+
+    tagNames.push_back(name);
+    return static_cast<uint32_t>(tagNames.size() - 1);
+}
+
+void Profiler::recordEvent(uint32_t tagId, Clock::time_point start, Clock::time_point end)
+{
+    getThreadBuffer().push({ tagId, NO_NODE, toTicks(start), toTicks(end) });
+}
+
+double Profiler::ticksToMilliseconds(int64_t ticks)
+{
+    return std::chrono::duration<double, std::milli>(Clock::duration(ticks)).count();
+}
+
 const Profiler::ProfileData* Profiler::getProfileData(const std::string& name)
 {
-    auto it = profileData.find(name);
-    return (it != profileData.end()) ? &it->second : nullptr;
+    std::lock_guard<std::mutex> lock(tagMutex);
+    for (size_t i = 0; i < tagNames.size() && i < profileData.size(); i++)
+    {
+        if (name == tagNames[i])
+        {
+            return &profileData[i];
+        }
+    }
+    return nullptr;
 }
 
 std::vector<std::pair<std::string, Profiler::ProfileData>> Profiler::getAllProfileData()
 {
     std::vector<std::pair<std::string, ProfileData>> result;
-    result.reserve(profileData.size());
-
-    for (const auto& pair : profileData)
     {
-        result.push_back(pair);
+        std::lock_guard<std::mutex> lock(tagMutex);
+        result.reserve(profileData.size());
+
+        for (size_t i = 0; i < tagNames.size() && i < profileData.size(); i++)
+        {
+            result.emplace_back(tagNames[i], profileData[i]);
+        }
     }
 
     // Sort by average time (descending)
@@ -90,12 +509,56 @@ std::vector<std::pair<std::string, Profiler::ProfileData>> Profiler::getAllProfi
     return result;
 }
 
+bool Profiler::getPercentiles(const std::string& name, Percentiles& out)
+{
+    const RollingHistogram* histogram = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(tagMutex);
+        for (size_t i = 0; i < tagNames.size() && i < histograms.size(); i++)
+        {
+            if (name == tagNames[i])
+            {
+                histogram = histograms[i].get();
+                break;
+            }
+        }
+    }
+
+    if (!histogram)
+    {
+        return false;
+    }
+
+    static const double percentiles[4] = { 50.0, 90.0, 99.0, 99.9 };
+    uint64_t values[4];
+    histogram->getPercentiles(percentiles, values, 4);
+
+    out.p50 = values[0] * 1e-6;
+    out.p90 = values[1] * 1e-6;
+    out.p99 = values[2] * 1e-6;
+    out.p999 = values[3] * 1e-6;
+    out.sampleCount = histogram->getTotalCount();
+    return true;
+}
+
+// Percentile histograms aren't cleared, their window only moves forward by one interval
 void Profiler::resetAllProfiles()
 {
-    for (auto& pair : profileData)
+    for (auto& data : profileData)
     {
-        pair.second.reset();
+        data.reset();
     }
+    for (auto& histogram : histograms)
+    {
+        histogram->advanceWindow();
+    }
+    for (auto& node : callTree)
+    {
+        node.totalTime = 0.0;
+        node.maxTime = 0.0;
+        node.callCount = 0;
+    }
+    droppedEvents = 0;
 }
 
 void Profiler::printProfileReport()
@@ -104,12 +567,16 @@ void Profiler::printProfileReport()
     std::cout << std::fixed << std::setprecision(4);
     std::cout << std::left;
     std::cout << std::setw(30) << "Function/Section"
-        << std::setw(12) << "Avg (ms)"
-        << std::setw(12) << "Min (ms)"
-        << std::setw(12) << "Max (ms)"
-        << std::setw(15) << "Total (ms)"
+        << std::setw(10) << "Avg (ms)"
+        << std::setw(10) << "Min (ms)"
+        << std::setw(10) << "Max (ms)"
+        << std::setw(10) << "p50"
+        << std::setw(10) << "p90"
+        << std::setw(10) << "p99"
+        << std::setw(10) << "p99.9"
+        << std::setw(13) << "Total (ms)"
         << std::setw(10) << "Calls" << "\n";
-    std::cout << std::string(100, '-') << "\n";
+    std::cout << std::string(130, '-') << "\n";
 
     auto sortedData = getAllProfileData();
     double totalProfiledTime = 0.0;
@@ -133,14 +600,23 @@ void Profiler::printProfileReport()
 
         double minTime = (data.minTime == std::numeric_limits<double>::max()) ? 0.0 : data.minTime;
 
-        std::cout << std::setw(30) << name.substr(0, 29) // Truncate long names
-            << std::setw(12) << data.getAverageTime()
-            << std::setw(12) << minTime
-            << std::setw(12) << data.maxTime
-            << std::setw(15) << data.totalTime
+        Percentiles percentiles;
+        getPercentiles(name, percentiles);
+
+        std::cout << std::setprecision(4)
+            << std::setw(30) << name.substr(0, 29) // Truncate long names
+            << std::setw(10) << data.getAverageTime()
+            << std::setw(10) << minTime
+            << std::setw(10) << data.maxTime
+            << std::setw(10) << percentiles.p50
+            << std::setw(10) << percentiles.p90
+            << std::setw(10) << percentiles.p99
+            << std::setw(10) << percentiles.p999
+            << std::setw(13) << data.totalTime
             << std::setw(10) << data.callCount;
 
         // Show percentage of total frame time if we have frame data
+        // Sections running on worker threads can exceed 100%
         const ProfileData* frameData = getProfileData("Frame Total");
         if (frameData && frameData->totalTime > 0.0 && name != "Frame Total")
         {
@@ -151,7 +627,7 @@ void Profiler::printProfileReport()
         std::cout << "\n";
     }
 
-    std::cout << std::string(100, '-') << "\n";
+    std::cout << std::string(130, '-') << "\n";
 
     // Show summary information
     const ProfileData* frameData = getProfileData("Frame Total");
@@ -180,30 +656,241 @@ void Profiler::printProfileReport()
                 << std::setprecision(2) << (1000.0 / frameData->minTime)
                 << " FPS)" << "\n";
         }
+
+        // Show frame time percentiles over the whole window
+        Percentiles framePercentiles;
+        if (getPercentiles("Frame Total", framePercentiles) && framePercentiles.sampleCount > 0)
+        {
+            std::cout << "  Frame time p50/p90/p99/p99.9: " << std::setprecision(2)
+                << framePercentiles.p50 << " / " << framePercentiles.p90 << " / "
+                << framePercentiles.p99 << " / " << framePercentiles.p999 << " ms"
+                << " (last " << framePercentiles.sampleCount << " frames)\n";
+        }
     }
 
-    std::cout << std::string(100, '=') << std::endl;
+    if (droppedEvents > 0)
+    {
+        std::cout << "  Dropped events: " << droppedEvents << "\n";
+    }
+
+    std::cout << std::string(130, '=') << std::endl;
 }
 
-ScopedProfiler::ScopedProfiler(const std::string& profileName) : name(profileName)
+void Profiler::setThreadName(const std::string& name)
 {
-    startTime = std::chrono::high_resolution_clock::now();
+    ThreadEventBuffer& buffer = getThreadBuffer();
+
+    std::lock_guard<std::mutex> lock(bufferMutex);
+    buffer.threadName = name;
 }
 
-ScopedProfiler::~ScopedProfiler()
+void Profiler::requestCapture(int frameCount)
+{
+    if (isCapturing() || frameCount <= 0)
+    {
+        return;
+    }
+    captureFramesRemaining = frameCount;
+}
+
+void Profiler::setAutoCapture(double frameTimeThreshold, int frameCount)
+{
+    autoCaptureThreshold = frameTimeThreshold;
+    autoCaptureFrames = std::max(frameCount, 1);
+}
+
+void Profiler::setHitchCapture(double frameTimeThreshold, double windowSeconds)
+{
+    hitchThreshold = frameTimeThreshold;
+    hitchWindow = windowSeconds;
+}
+
+void Profiler::setCounter(const ProfileTag& tag, double value)
+{
+    frameCounters.push_back({ tag.getId(), toTicks(Clock::now()), value });
+}
+
+static void writeJsonString(std::ostream& out, const char* str)
+{
+    out << '"';
+    for (const char* c = str; *c; c++)
+    {
+        if (*c == '"' || *c == '\\')
+        {
+            out << '\\';
+        }
+        out << *c;
+    }
+    out << '"';
+}
+
+bool Profiler::writeChromeTrace(const std::string& path, const std::vector<CapturedEvent>& events,
+    const std::vector<CounterSample>& counters)
+{
+    std::ofstream file(path);
+    if (!file)
+    {
+        return false;
+    }
+
+    // Timestamps are microseconds relative to the first event
+    int64_t originTicks = std::numeric_limits<int64_t>::max();
+    for (const CapturedEvent& event : events)
+    {
+        originTicks = std::min(originTicks, event.startTicks);
+    }
+    for (const CounterSample& counter : counters)
+    {
+        originTicks = std::min(originTicks, counter.ticks);
+    }
+
+    std::vector<const char*> names;
+    {
+        std::lock_guard<std::mutex> lock(tagMutex);
+        names = tagNames;
+    }
+
+    file << std::fixed << std::setprecision(3);
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+    bool first = true;
+    {
+        std::lock_guard<std::mutex> lock(bufferMutex);
+        for (const auto& buffer : threadBuffers)
+        {
+            std::string threadName = buffer->threadName.empty()
+                ? "Thread " + std::to_string(buffer->getThreadIndex())
+                : buffer->threadName;
+
+            if (!first) file << ",\n";
+            first = false;
+
+            file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->getThreadIndex() << ",\"args\":{\"name\":";
+            writeJsonString(file, threadName.c_str());
+            file << "}}";
+        }
+    }
+
+    for (const CapturedEvent& event : events)
+    {
+        if (!first) file << ",\n";
+        first = false;
+
+        file << "{\"name\":";
+        writeJsonString(file, event.tagId < names.size() ? names[event.tagId] : "Unknown");
+        file << ",\"cat\":\"VoxEngine\",\"ph\":\"X\""
+            << ",\"ts\":" << ticksToMilliseconds(event.startTicks - originTicks) * 1000.0
+            << ",\"dur\":" << ticksToMilliseconds(event.endTicks - event.startTicks) * 1000.0
+            << ",\"pid\":1,\"tid\":" << event.threadIndex << "}";
+    }
+
+    for (const CounterSample& counter : counters)
+    {
+        if (!first) file << ",\n";
+        first = false;
+
+        const char* name = counter.tagId < names.size() ? names[counter.tagId] : "Unknown";
+        file << "{\"name\":";
+        writeJsonString(file, name);
+        file << ",\"ph\":\"C\",\"ts\":" << ticksToMilliseconds(counter.ticks - originTicks) * 1000.0
+            << ",\"pid\":1,\"args\":{\"value\":" << counter.value << "}}";
+    }
+
+    file << "\n]}\n";
+    return file.good();
+}
+
+void Profiler::printCallTreeNode(uint32_t node, int depth, double frameTotalTime)
 {
-    auto endTime = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+    const CallTreeNode& treeNode = callTree[node];
+
+    // Exclusive time is what isn't covered by child scopes
+    double childTime = 0.0;
+    for (uint32_t child : treeNode.children)
+    {
+        childTime += callTree[child].totalTime;
+    }
+    double selfTime = std::max(treeNode.totalTime - childTime, 0.0);
+
+    std::string name = std::string(depth * 2, ' ') + tagNames[treeNode.tagId];
+
+    std::cout << std::setprecision(4)
+        << std::setw(40) << name.substr(0, 39) // Truncate long names
+        << std::setw(13) << treeNode.totalTime
+        << std::setw(13) << selfTime
+        << std::setw(10) << treeNode.maxTime
+        << std::setw(10) << treeNode.callCount;
+
+    if (frameTotalTime > 0.0)
+    {
+        std::cout << std::setw(8) << std::setprecision(1) << (treeNode.totalTime / frameTotalTime) * 100.0 << "%";
+    }
+    std::cout << "\n";
 
-    auto it = Profiler::profileData.find(name);
-    if (it != Profiler::profileData.end())
+    std::vector<uint32_t> children = treeNode.children;
+    std::sort(children.begin(), children.end(),
+        [](uint32_t a, uint32_t b) {
+            return callTree[a].totalTime > callTree[b].totalTime;
+        });
+
+    for (uint32_t child : children)
     {
-        it->second.addSample(duration);
+        if (callTree[child].callCount > 0)
+        {
+            printCallTreeNode(child, depth + 1, frameTotalTime);
+        }
     }
-    else
+}
+
+void Profiler::printCallTreeReport()
+{
+    std::cout << "\n=== CALL TREE ===\n";
+    std::cout << std::fixed << std::setprecision(4);
+    std::cout << std::left;
+    std::cout << std::setw(40) << "Section"
+        << std::setw(13) << "Incl (ms)"
+        << std::setw(13) << "Excl (ms)"
+        << std::setw(10) << "Max (ms)"
+        << std::setw(10) << "Calls"
+        << "% of frame" << "\n";
+    std::cout << std::string(100, '-') << "\n";
+
+    const ProfileData* frameData = getProfileData("Frame Total");
+    double frameTotalTime = frameData ? frameData->totalTime : 0.0;
+
+    std::vector<uint32_t> roots = callTreeRoots;
+    std::sort(roots.begin(), roots.end(),
+        [](uint32_t a, uint32_t b) {
+            return callTree[a].totalTime > callTree[b].totalTime;
+        });
+
+    // Tag names are only appended, reading them while another thread registers one is guarded
+    std::lock_guard<std::mutex> lock(tagMutex);
+    for (uint32_t root : roots)
     {
-        Profiler::ProfileData data;
-        data.addSample(duration);
-        Profiler::profileData[name] = data;
+        if (callTree[root].callCount > 0)
+        {
+            printCallTreeNode(root, 0, frameTotalTime);
+        }
     }
+
+    std::cout << std::string(100, '=') << std::endl;
+}
+
+//============================================================================
+// ScopedProfiler
+
+ScopedProfiler::ScopedProfiler(const ProfileTag& tag) :
+    buffer(&Profiler::getThreadBuffer()), tagId(tag.getId())
+{
+    parentNode = buffer->getCurrentNode();
+    callNode = buffer->enterScope(tagId);
+    startTime = Profiler::Clock::now();
+}
+
+ScopedProfiler::~ScopedProfiler()
+{
+    auto endTime = Profiler::Clock::now();
+    buffer->push({ tagId, callNode, Profiler::toTicks(startTime), Profiler::toTicks(endTime) });
+    buffer->leaveScope(parentNode);
 }
@@ -1,13 +1,40 @@
 #pragma once
+#include "Histogram.h"
+
 #include <chrono>
-#include <unordered_map>
 #include <string>
 #include <vector>
+#include <deque>
 #include <limits>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <cstdint>
+
+// Identifies a profiled section. PROFILE_SCOPE creates one static tag per call site,
+// so the name is a string literal and is registered only once, on first use.
+// Sections with the same name share an id.
+class ProfileTag
+{
+    const char* name;
+    uint32_t id;
+public:
+    explicit ProfileTag(const char* name);
+
+    ProfileTag(const ProfileTag&) = delete;
+    ProfileTag& operator=(const ProfileTag&) = delete;
+
+    const char* getName() const { return name; }
+    uint32_t getId() const { return id; }
+};
 
 class Profiler
 {
 public:
+    using Clock = std::chrono::high_resolution_clock;
+
     struct ProfileData
     {
         double totalTime = 0.0;
@@ -20,10 +47,174 @@ public:
         void reset();
     };
 
+    // Percentiles over the rolling window, not only the last report interval
+    struct Percentiles
+    {
+        double p50 = 0.0;
+        double p90 = 0.0;
+        double p99 = 0.0;
+        double p999 = 0.0;
+        uint64_t sampleCount = 0;
+    };
+
+    static constexpr uint32_t NO_NODE = 0xFFFFFFFF;
+
+    struct ProfileEvent
+    {
+        uint32_t tagId;
+        uint32_t callNode; // Node in the recording thread's call tree, NO_NODE if unknown
+        int64_t startTicks;
+        int64_t endTicks;
+    };
+
+    // Single producer (owning thread), single consumer (main thread in endFrame) ring buffer
+    class ThreadEventBuffer
+    {
+    public:
+        static constexpr size_t CAPACITY = 1 << 13;
+        static constexpr size_t MASK = CAPACITY - 1;
+        static constexpr uint32_t MAX_CALL_NODES = 1024;
+
+        // Call path of a scope. Only the owning thread adds nodes, tagId and parent never change after that.
+        struct CallNode
+        {
+            uint32_t tagId;
+            uint32_t parent;
+            uint32_t firstChild;
+            uint32_t nextSibling;
+        };
+    private:
+        ProfileEvent events[CAPACITY];
+        std::atomic<size_t> writeIndex;
+        std::atomic<size_t> readIndex;
+        std::atomic<uint64_t> droppedEvents;
+        uint32_t threadIndex;
+
+        CallNode callNodes[MAX_CALL_NODES];
+        uint32_t callNodeCount;
+        uint32_t firstRootNode;
+        uint32_t currentNode; // Top of the scope stack
+    public:
+        ThreadEventBuffer(uint32_t threadIndex);
+
+        ThreadEventBuffer(const ThreadEventBuffer&) = delete;
+        ThreadEventBuffer& operator=(const ThreadEventBuffer&) = delete;
+
+        void push(const ProfileEvent& event);
+
+        template<typename Func>
+        void consume(Func func);
+
+        uint64_t takeDroppedEvents();
+        uint32_t getThreadIndex() const { return threadIndex; }
+
+        // Owning thread only
+        uint32_t enterScope(uint32_t tagId);
+        void leaveScope(uint32_t parentNode) { currentNode = parentNode; }
+        uint32_t getCurrentNode() const { return currentNode; }
+
+        // Nodes referenced by consumed events are safe to read
+        const CallNode& getCallNode(uint32_t node) const { return callNodes[node]; }
+
+        std::string threadName; // Protected by bufferMutex
+        std::vector<uint32_t> globalCallNodes; // Collecting thread only, maps call nodes into Profiler::callTree
+    };
+
+    // Call tree merged from all threads
+    struct CallTreeNode
+    {
+        uint32_t tagId;
+        uint32_t parent;
+        std::vector<uint32_t> children;
+
+        double totalTime = 0.0; // Inclusive
+        double maxTime = 0.0;
+        uint64_t callCount = 0;
+    };
+
+    struct CapturedEvent
+    {
+        uint32_t tagId;
+        uint32_t threadIndex;
+        int64_t startTicks;
+        int64_t endTicks;
+    };
+
+    struct CounterSample
+    {
+        uint32_t tagId;
+        int64_t ticks;
+        double value;
+    };
+
 private:
-    static std::unordered_map<std::string, ProfileData> profileData;
-    static std::chrono::high_resolution_clock::time_point frameStartTime;
+    static std::mutex tagMutex; // Protects tagNames
+    static std::vector<const char*> tagNames;
+
+    static std::mutex bufferMutex; // Protects threadBuffers
+    static std::vector<std::unique_ptr<ThreadEventBuffer>> threadBuffers;
+
+    // Only touched by the thread calling beginFrame/endFrame
+    static std::vector<ProfileData> profileData; // Indexed by tag id
+    static std::vector<std::unique_ptr<RollingHistogram>> histograms; // Nanoseconds, indexed by tag id
+    static std::vector<CallTreeNode> callTree;
+    static std::vector<uint32_t> callTreeRoots;
+    static uint32_t frameNode;
+    static uint32_t frameParentNode;
+    static Clock::time_point frameStartTime;
     static double lastFrameTime;
+    static uint64_t droppedEvents;
+
+    // Events of the last collected frame, with thread index
+    static std::vector<CapturedEvent> frameEvents;
+    static std::vector<CounterSample> frameCounters;
+
+    // Timeline capture
+    static std::vector<CapturedEvent> capturedEvents;
+    static int captureFramesRemaining;
+    static int captureCount;
+    static double autoCaptureThreshold; // Milliseconds, 0 disables
+    static int autoCaptureFrames;
+
+    // Hitch capture, always-on buffer of the frames inside the hitch window
+    struct HitchFrame
+    {
+        int64_t startTicks = 0;
+        int64_t endTicks = 0;
+        std::vector<CapturedEvent> events;
+        std::vector<CounterSample> counters;
+    };
+    static constexpr size_t MAX_HITCH_EVENTS = 1 << 20; // All frames together, oldest frames are dropped first
+    static constexpr size_t MAX_HITCH_FRAME_EVENTS = 1 << 14;
+    static std::deque<HitchFrame> hitchFrames;
+    static size_t hitchEventCount;
+    static double hitchThreshold; // Milliseconds, 0 disables
+    static double hitchWindow; // Seconds
+    static int64_t lastHitchTicks;
+    static int hitchCount;
+
+    // Hitch files are written on their own thread, shutdown() waits for the queued ones
+    struct HitchWrite
+    {
+        std::string path;
+        std::vector<CapturedEvent> events;
+        std::vector<CounterSample> counters;
+    };
+    static std::mutex hitchWriteMutex; // Protects hitchWrites and hitchWriterStop
+    static std::condition_variable hitchWriteCondition;
+    static std::vector<HitchWrite> hitchWrites;
+    static bool hitchWriterStop;
+    static std::thread hitchWriterThread; // Started on the first hitch
+
+    static ThreadEventBuffer& getThreadBuffer();
+    static const ProfileTag& getFrameTag();
+    static void collectEvents();
+    static void ensureTagStorage(size_t tagCount);
+    static uint32_t mapCallNode(ThreadEventBuffer& buffer, uint32_t node);
+    static void printCallTreeNode(uint32_t node, int depth, double frameTotalTime);
+    static void updateCapture();
+    static void updateHitchCapture(int64_t frameStartTicks, int64_t frameEndTicks);
+    static void hitchWriterThreadMain();
 
 public:
     static void beginFrame();
@@ -33,29 +224,73 @@ public:
     static void beginProfile(const std::string& name);
     static void endProfile(const std::string& name);
 
+    static uint32_t registerTag(const char* name);
+    static void recordEvent(uint32_t tagId, Clock::time_point start, Clock::time_point end);
+
     static const ProfileData* getProfileData(const std::string& name);
     static std::vector<std::pair<std::string, ProfileData>> getAllProfileData();
+    static bool getPercentiles(const std::string& name, Percentiles& out);
 
     static void resetAllProfiles();
     static void printProfileReport();
+    static void printCallTreeReport();
+
+    static void setThreadName(const std::string& name);
+
+    // Timeline capture, written as Chrome trace-event JSON (chrome://tracing, Perfetto)
+    static void requestCapture(int frameCount);
+    static void setAutoCapture(double frameTimeThreshold, int frameCount);
+    static bool isCapturing() { return captureFramesRemaining > 0; }
+    static bool writeChromeTrace(const std::string& path, const std::vector<CapturedEvent>& events,
+        const std::vector<CounterSample>& counters = {});
+
+    // Frames slower than the threshold dump the last 'windowSeconds' of events and counters to hitch_N.json
+    static void setHitchCapture(double frameTimeThreshold, double windowSeconds);
+
+    // Finishes writing pending hitch files. Call before exiting, a file cut off at exit is unreadable.
+    static void shutdown();
+
+    // Counters are sampled on the main thread, e.g. queue depths
+    static void setCounter(const ProfileTag& tag, double value);
+
+    static int64_t toTicks(Clock::time_point time) { return time.time_since_epoch().count(); }
+    static double ticksToMilliseconds(int64_t ticks);
 
     // Allow ScopedProfiler access to private members
     friend class ScopedProfiler;
 };
 
-// RAII helper class for automatic profiling
+template<typename Func>
+inline void Profiler::ThreadEventBuffer::consume(Func func)
+{
+    size_t read = readIndex.load(std::memory_order_relaxed);
+    size_t write = writeIndex.load(std::memory_order_acquire);
+
+    for (size_t i = read; i != write; i++)
+    {
+        func(events[i & MASK]);
+    }
+
+    readIndex.store(write, std::memory_order_release);
+}
+
+// RAII helper class for automatic profiling. Safe to use on any thread.
 class ScopedProfiler
 {
 private:
-    std::string name;
-    std::chrono::high_resolution_clock::time_point startTime;
+    Profiler::ThreadEventBuffer* buffer;
+    uint32_t tagId;
+    uint32_t callNode;
+    uint32_t parentNode;
+    Profiler::Clock::time_point startTime;
 
 public:
-    ScopedProfiler(const std::string& profileName);
+    ScopedProfiler(const ProfileTag& tag);
 
     ~ScopedProfiler();
 };
 
 // Convenience macros for easy profiling
-#define PROFILE_SCOPE(name) ScopedProfiler _prof(name)
-#define PROFILE_FUNCTION() ScopedProfiler _prof(__FUNCTION__)
\ No newline at end of file
+#define PROFILE_SCOPE(name) static const ProfileTag _profTag(name); ScopedProfiler _prof(_profTag)
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__FUNCTION__)
+#define PROFILE_COUNTER(name, value) { static const ProfileTag _profCounterTag(name); Profiler::setCounter(_profCounterTag, static_cast<double>(value)); }
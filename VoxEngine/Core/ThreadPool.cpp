@@ -1,4 +1,5 @@
 #include "ThreadPool.h"
+#include "Profiler.h"
 
 ThreadPool::ThreadPool(size_t numThreads) : stop(false)
 {
@@ -47,8 +48,16 @@ size_t ThreadPool::getThreadCount() const
     return workers.size();
 }
 
+size_t ThreadPool::getPendingTaskCount() const
+{
+    std::unique_lock<std::mutex> lock(queueMutex);
+    return tasks.size();
+}
+
 void ThreadPool::workerThread()
 {
+    Profiler::setThreadName("Worker thread");
+
     while(true)
     {
         std::function<void()> task;
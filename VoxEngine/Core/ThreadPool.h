@@ -13,7 +13,7 @@ class ThreadPool
 {
 	std::vector<std::thread> workers;
 	std::queue<std::function<void()>> tasks;
-	std::mutex queueMutex;
+	mutable std::mutex queueMutex;
 	std::condition_variable condition;
 	std::atomic<bool> stop;
 public:
@@ -26,6 +26,7 @@ public:
 
 	void waitForCompletion();
     size_t getThreadCount() const;
+    size_t getPendingTaskCount() const;
 private:
 	void workerThread();
 };
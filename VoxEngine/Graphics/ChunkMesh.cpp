@@ -0,0 +1,85 @@
+#include "ChunkMesh.h"
+
+#include "Vec2.h"
+
+ChunkMesh::ChunkMesh() :
+	vao(0), vbo(0), instanceVBO(0), faceCount(0), faceCapacity(0)
+{
+	Vec2 vertices[4] = // CCW order
+	{
+		{ 0.0f, 0.0f },
+		{ 1.0f, 0.0f },
+		{ 1.0f, 1.0f },
+		{ 0.0f, 1.0f }
+	};
+
+	glGenVertexArrays(1, &vao);
+	glGenBuffers(1, &vbo);
+	glGenBuffers(1, &instanceVBO);
+
+	// Bind VAO
+	glBindVertexArray(vao);
+
+	// Vertex buffer
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vec2), (void*)0);
+
+	// Instance buffer
+	glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+	glEnableVertexAttribArray(1);
+	glVertexAttribIPointer(1, 1, GL_INT, sizeof(BlockFaceInstance), (void*)0); // integer attribute
+	glVertexAttribDivisor(1, 1); // advance per instance
+}
+
+ChunkMesh::~ChunkMesh()
+{
+	// Delete buffers
+	if (instanceVBO)
+	{
+		glDeleteBuffers(1, &instanceVBO);
+		instanceVBO = 0;
+	}
+	if (vbo)
+	{
+		glDeleteBuffers(1, &vbo);
+		vbo = 0;
+	}
+	if (vao)
+	{
+		glDeleteVertexArrays(1, &vao);
+		vao = 0;
+	}
+
+	faceCapacity = 0;
+}
+
+void ChunkMesh::upload(const std::vector<BlockFaceInstance>& faces)
+{
+	// TODO: Maybe have a single VBO/VAO for all chunks, since they use the same vertices? If possible, I dunno.
+
+	// TODO: Maybe have a pool for instance buffers? Chunk should ask for the minimum sized buffer that fits his needs.
+	// If there's none, it gets closest one and changes its size.
+
+	// Instance buffer
+	faceCount = faces.size();
+
+	glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+	if (faceCount > faceCapacity)
+	{
+		faceCapacity = faceCount;
+		glBufferData(GL_ARRAY_BUFFER, faceCount * sizeof(BlockFaceInstance), faces.data(), GL_STATIC_DRAW);
+	}
+	else
+	{
+		glBufferSubData(GL_ARRAY_BUFFER, 0, faceCount * sizeof(BlockFaceInstance), faces.data());
+	}
+}
+
+void ChunkMesh::render() const
+{
+	if (faceCount == 0) return;
+	glBindVertexArray(vao);
+	glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, 4, faceCount);
+}
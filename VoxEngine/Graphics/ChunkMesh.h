@@ -0,0 +1,52 @@
+#pragma once
+#include "../Block.h"
+
+#include <glad/glad.h>
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+struct BlockFaceInstance
+{
+	int32_t data;
+
+	BlockFaceInstance(int x, int y, int z, int normal, Block block, int light) : data(0)
+	{
+		// Coords 12 bits
+		data |= (x & 15);
+		data |= (y & 15) << 4;
+		data |= (z & 15) << 8;
+
+		// Normal 3 bits
+		data |= (normal & 7) << 12;
+
+		// Block type 4 bits, light 4 bits
+		data |= (static_cast<int>(block) & 15) << 15;
+		data |= (light & 15) << 19;
+	}
+};
+
+// GPU side of a chunk. Chunks create it on their first mesh upload, so the simulation never touches OpenGL.
+// Main thread only, needs a current OpenGL context.
+class ChunkMesh
+{
+	GLuint vao, vbo, instanceVBO;
+	size_t faceCount;
+	size_t faceCapacity;
+public:
+	ChunkMesh();
+	~ChunkMesh();
+
+	ChunkMesh(const ChunkMesh&) = delete;
+	ChunkMesh& operator=(const ChunkMesh&) = delete;
+	ChunkMesh(ChunkMesh&&) = delete;
+	ChunkMesh& operator=(ChunkMesh&&) = delete;
+
+	void upload(const std::vector<BlockFaceInstance>& faces);
+	void clear() { faceCount = 0; } // Keeps the buffers for the next upload
+	void render() const;
+
+	size_t getFaceCount() const { return faceCount; }
+	size_t getFaceCapacity() const { return faceCapacity; }
+};
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstdint>
+
+// Game actions, bound to keys in WindowManager::getInputState
+enum class InputKey : uint8_t
+{
+	Forward,
+	Back,
+	Left,
+	Right,
+	Up,
+	Down,
+	Sprint,
+	RebuildMeshes,
+	DebugMethod,
+	Backup,
+	CaptureTimeline,
+	Count
+};
+
+// Input of one frame. Player and the main loop read this instead of the window,
+// so a recorded session can be replayed without a keyboard or mouse.
+struct InputState
+{
+	uint32_t keys = 0; // Bit per InputKey
+	float mouseX = 0.0f;
+	float mouseY = 0.0f;
+
+	bool isKeyPressed(InputKey key) const { return (keys >> static_cast<uint32_t>(key)) & 1; }
+	void setKeyPressed(InputKey key, bool pressed)
+	{
+		const uint32_t bit = 1u << static_cast<uint32_t>(key);
+		keys = pressed ? keys | bit : keys & ~bit;
+	}
+};
@@ -5,4 +5,10 @@ constexpr int CHUNK_SIZE = 16;
 constexpr int CHUNK_AREA = CHUNK_SIZE * CHUNK_SIZE;
 constexpr int CHUNK_VOLUME = CHUNK_SIZE * CHUNK_SIZE * CHUNK_SIZE;
 constexpr int CHUNK_LOWER_BITS_MASK = CHUNK_SIZE - 1;
-constexpr int CHUNK_UPPER_BITS_MASK = ~CHUNK_LOWER_BITS_MASK;
\ No newline at end of file
+constexpr int CHUNK_UPPER_BITS_MASK = ~CHUNK_LOWER_BITS_MASK;
+
+// Index of a block inside a chunk's array, z is the fastest axis
+constexpr int getChunkBlockIndex(int x, int y, int z)
+{
+	return (x << 8) | (y << 4) | z;
+}
\ No newline at end of file
@@ -6,19 +6,19 @@ Player::Player(const glm::vec3& position, float yaw, float pitch) :
 {
 }
 
-void Player::update(const WindowManager& wnd, float deltaTime, glm::vec2& lastMousePos)
+void Player::update(const InputState& input, float deltaTime, glm::vec2& lastMousePos)
 {
 	previousTransform = transform;
 
     // Position
     {
-		bool sprint = wnd.isKeyPressed(GLFW_KEY_LEFT_SHIFT);
+		bool sprint = input.isKeyPressed(InputKey::Sprint);
 
         const float cameraSpeed = (sprint ? 2.0f : 1.0f) * (15.0f * deltaTime);
 
-        float leftRight = wnd.isKeyPressed(GLFW_KEY_D) - wnd.isKeyPressed(GLFW_KEY_A);
-        float forwardBackward = wnd.isKeyPressed(GLFW_KEY_W) - wnd.isKeyPressed(GLFW_KEY_S);
-        float worldUpDown = wnd.isKeyPressed(GLFW_KEY_SPACE) - wnd.isKeyPressed(GLFW_KEY_LEFT_CONTROL);
+        float leftRight = input.isKeyPressed(InputKey::Right) - input.isKeyPressed(InputKey::Left);
+        float forwardBackward = input.isKeyPressed(InputKey::Forward) - input.isKeyPressed(InputKey::Back);
+        float worldUpDown = input.isKeyPressed(InputKey::Up) - input.isKeyPressed(InputKey::Down);
 
         glm::vec3 movementVector = glm::vec3(0.0f);
 
@@ -36,14 +36,11 @@ void Player::update(const WindowManager& wnd, float deltaTime, glm::vec2& lastMo
     {
         const float mouseSensitivity = 0.002f;
 
-        float mouseX, mouseY;
-        wnd.getMousePos(mouseX, mouseY);
+        float offsetX = input.mouseX - lastMousePos.x;
+        float offsetY = input.mouseY - lastMousePos.y;
 
-        float offsetX = mouseX - lastMousePos.x;
-        float offsetY = mouseY - lastMousePos.y;
-
-        lastMousePos.x = mouseX;
-        lastMousePos.y = mouseY;
+        lastMousePos.x = input.mouseX;
+        lastMousePos.y = input.mouseY;
 
         rotate(-offsetX * mouseSensitivity, -offsetY * mouseSensitivity);
     }
@@ -1,5 +1,5 @@
 #pragma once
-#include "WindowManager.h" // TODO: Should be removed, but needed for input
+#include "InputState.h"
 #include "Graphics/Camera.h"
 
 class Player
@@ -11,7 +11,7 @@ class Player
 public:
 	Player(const glm::vec3& position, float yaw, float pitch);
 
-	void update(const WindowManager& wnd, float deltaTime, glm::vec2& lastMousePos);
+	void update(const InputState& input, float deltaTime, glm::vec2& lastMousePos);
 	void interpolateCameraTransform(float factor);
 
 	void setPosition(const glm::vec3& position);
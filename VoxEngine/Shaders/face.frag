@@ -1,10 +1,32 @@
 #version 460 core
 
 in vec2 uv;
+flat in int blockType;
+in float light;
 
 out vec4 FragColor;
 
+// Indexed by Block
+const vec3 blockColors[9] = vec3[9](
+	vec3(1.0, 0.0, 1.0),    // Air, never meshed
+	vec3(0.5, 0.5, 0.52),   // Solid
+	vec3(0.45, 0.3, 0.18),  // Dirt
+	vec3(0.3, 0.6, 0.2),    // Grass
+	vec3(0.4, 0.27, 0.13),  // Wood
+	vec3(0.2, 0.45, 0.15),  // Leaves
+	vec3(0.25, 0.25, 0.3),  // Ore
+	vec3(0.86, 0.8, 0.55),  // Sand
+	vec3(0.93, 0.95, 0.97)  // Snow
+);
+
 void main()
 {
-	FragColor = vec4(uv, 0.0, 1.0);
+	vec3 color = blockColors[clamp(blockType, 0, 8)];
+
+	// Darker block edges
+	vec2 edge = min(uv, 1.0 - uv);
+	float edgeShade = min(edge.x, edge.y) < 0.04 ? 0.8 : 1.0;
+
+	float brightness = 0.15 + 0.85 * light;
+	FragColor = vec4(color * edgeShade * brightness, 1.0);
 }
\ No newline at end of file
@@ -8,6 +8,8 @@ uniform mat4 projection;
 uniform vec3 chunkPosition;
 
 out vec2 uv;
+flat out int blockType;
+out float light;
 
 void main()
 {
@@ -18,6 +20,9 @@ void main()
 
     int normal = (instanceData >> 12) & 7;
 
+    int type = (instanceData >> 15) & 15;
+    int skyLight = (instanceData >> 19) & 15;
+
     // Move quad to face
     vec3 vertexPos = vec3(0.0);
     vec2 vertexUV = vec2(0.0);
@@ -55,6 +60,8 @@ void main()
 
     //
     uv = vertexUV;
+    blockType = type;
+    light = float(skyLight) / 15.0;
 
     vec3 worldPos = chunkPosition + vertexPos + vec3(x, y, z);
     gl_Position = projection * view * vec4(worldPos, 1.0);
@@ -0,0 +1,197 @@
+#include "ChunkCodec.h"
+
+#include <cstring>
+
+static void writeVarint(uint32_t value, std::vector<uint8_t>& out)
+{
+	while (value >= 0x80)
+	{
+		out.push_back(static_cast<uint8_t>(value | 0x80));
+		value >>= 7;
+	}
+	out.push_back(static_cast<uint8_t>(value));
+}
+
+static bool readVarint(const uint8_t*& data, const uint8_t* end, uint32_t& value)
+{
+	value = 0;
+	for (int shift = 0; shift < 32; shift += 7)
+	{
+		if (data == end)
+		{
+			return false;
+		}
+		uint8_t byte = *data++;
+		value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+		if (!(byte & 0x80))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void ChunkCodec::encode(const Block* blocks, std::vector<uint8_t>& out)
+{
+	// Palette in order of first appearance
+	int paletteIndex[256];
+	for (int& index : paletteIndex) index = -1;
+
+	uint8_t palette[256];
+	int paletteSize = 0;
+	for (int i = 0; i < CHUNK_VOLUME; i++)
+	{
+		uint8_t value = static_cast<uint8_t>(blocks[i]);
+		if (paletteIndex[value] < 0)
+		{
+			paletteIndex[value] = paletteSize;
+			palette[paletteSize++] = value;
+		}
+	}
+
+	if (paletteSize == 1)
+	{
+		encodeUniform(blocks[0], out);
+		return;
+	}
+
+	out.push_back(static_cast<uint8_t>(Format::PaletteRLE));
+	out.push_back(static_cast<uint8_t>(paletteSize - 1));
+	out.insert(out.end(), palette, palette + paletteSize);
+
+	int runStart = 0;
+	for (int i = 1; i <= CHUNK_VOLUME; i++)
+	{
+		if (i == CHUNK_VOLUME || blocks[i] != blocks[runStart])
+		{
+			out.push_back(static_cast<uint8_t>(paletteIndex[static_cast<uint8_t>(blocks[runStart])]));
+			writeVarint(static_cast<uint32_t>(i - runStart - 1), out);
+			runStart = i;
+		}
+	}
+}
+
+void ChunkCodec::encodeUniform(Block block, std::vector<uint8_t>& out)
+{
+	out.push_back(static_cast<uint8_t>(Format::Uniform));
+	out.push_back(static_cast<uint8_t>(block));
+}
+
+void ChunkCodec::encodeDelta(const Block* blocks, const Block* baseBlocks, const DeltaStamp& stamp, std::vector<uint8_t>& out)
+{
+	uint32_t count = 0;
+	for (int i = 0; i < CHUNK_VOLUME; i++)
+	{
+		count += blocks[i] != baseBlocks[i] ? 1 : 0;
+	}
+
+	out.push_back(static_cast<uint8_t>(Format::Delta));
+	uint8_t stampBytes[sizeof(DeltaStamp)];
+	memcpy(stampBytes, &stamp, sizeof(stamp));
+	out.insert(out.end(), stampBytes, stampBytes + sizeof(stampBytes));
+	writeVarint(count, out);
+
+	int previous = -1;
+	for (int i = 0; i < CHUNK_VOLUME; i++)
+	{
+		if (blocks[i] != baseBlocks[i])
+		{
+			writeVarint(static_cast<uint32_t>(i - previous - 1), out);
+			out.push_back(static_cast<uint8_t>(blocks[i]));
+			previous = i;
+		}
+	}
+}
+
+bool ChunkCodec::readDeltaStamp(const uint8_t* data, size_t size, DeltaStamp& stamp)
+{
+	if (!isDelta(data, size) || size < 1 + sizeof(DeltaStamp))
+	{
+		return false;
+	}
+	memcpy(&stamp, data + 1, sizeof(stamp));
+	return true;
+}
+
+bool ChunkCodec::applyDelta(const uint8_t* data, size_t size, Block* blocks)
+{
+	const uint8_t* end = data + size;
+	if (!isDelta(data, size) || size < 1 + sizeof(DeltaStamp))
+	{
+		return false;
+	}
+	data += 1 + sizeof(DeltaStamp);
+
+	uint32_t count;
+	if (!readVarint(data, end, count) || count > CHUNK_VOLUME)
+	{
+		return false;
+	}
+
+	int index = -1;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		uint32_t gap;
+		if (!readVarint(data, end, gap) || gap >= static_cast<uint32_t>(CHUNK_VOLUME - index - 1) || data == end)
+		{
+			return false;
+		}
+		index += static_cast<int>(gap) + 1;
+		blocks[index] = static_cast<Block>(*data++);
+	}
+	return data == end;
+}
+
+bool ChunkCodec::decode(const uint8_t* data, size_t size, Block* blocks, bool& uniform, Block& uniformBlock)
+{
+	const uint8_t* end = data + size;
+	if (size < 2)
+	{
+		return false;
+	}
+
+	Format format = static_cast<Format>(*data++);
+	if (format == Format::Uniform)
+	{
+		uniform = true;
+		uniformBlock = static_cast<Block>(*data);
+		return size == 2;
+	}
+	if (format != Format::PaletteRLE)
+	{
+		return false;
+	}
+
+	int paletteSize = *data++ + 1;
+	if (end - data < paletteSize)
+	{
+		return false;
+	}
+	const uint8_t* palette = data;
+	data += paletteSize;
+
+	int index = 0;
+	while (index < CHUNK_VOLUME)
+	{
+		if (data == end)
+		{
+			return false;
+		}
+		uint8_t entry = *data++;
+
+		uint32_t runLength;
+		if (entry >= paletteSize || !readVarint(data, end, runLength) || runLength >= static_cast<uint32_t>(CHUNK_VOLUME - index))
+		{
+			return false;
+		}
+
+		Block block = static_cast<Block>(palette[entry]);
+		for (int last = index + static_cast<int>(runLength); index <= last; index++)
+		{
+			blocks[index] = block;
+		}
+	}
+
+	uniform = false;
+	return data == end;
+}
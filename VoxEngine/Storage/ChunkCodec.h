@@ -0,0 +1,41 @@
+#pragma once
+#include "../Block.h"
+#include "../Metrics.h"
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Serialized chunk blocks. Uniform chunks take two bytes, others a palette followed by runs
+// in getChunkBlockIndex order, so solid ground and open air collapse into few runs.
+// Deltas list only blocks that differ from the generator's output and are stamped with the seed and generator version.
+class ChunkCodec
+{
+public:
+	enum class Format : uint8_t
+	{
+		Uniform,    // One block type
+		PaletteRLE, // Palette, then (palette index, varint run length - 1) pairs
+		Delta       // Version and seed, varint count, then (varint index gap, block) pairs
+	};
+
+	struct DeltaStamp
+	{
+		uint32_t generatorVersion;
+		int32_t seed;
+	};
+
+	// Appends to 'out'
+	static void encode(const Block* blocks, std::vector<uint8_t>& out);
+	static void encodeUniform(Block block, std::vector<uint8_t>& out);
+
+	static void encodeDelta(const Block* blocks, const Block* baseBlocks, const DeltaStamp& stamp, std::vector<uint8_t>& out);
+
+	// False on malformed data. Uniform chunks only set 'uniformBlock', 'blocks' is left untouched.
+	static bool decode(const uint8_t* data, size_t size, Block* blocks, bool& uniform, Block& uniformBlock);
+
+	// Deltas are applied on top of 'blocks', which holds the base chunk generated with the same stamp
+	static bool isDelta(const uint8_t* data, size_t size) { return size > 0 && data[0] == static_cast<uint8_t>(Format::Delta); }
+	static bool readDeltaStamp(const uint8_t* data, size_t size, DeltaStamp& stamp);
+	static bool applyDelta(const uint8_t* data, size_t size, Block* blocks);
+};
@@ -0,0 +1,670 @@
+#include "ChunkStore.h"
+
+#include "ChunkCodec.h"
+#include "../TerrainGenerator.h"
+#include "Profiler.h"
+
+#include <iostream>
+#include <algorithm>
+#include <filesystem>
+
+ChunkStore::ChunkStore() :
+	generator(nullptr), storeDeltas(true), snapshotSaveBoundary(0), snapshotCaptureEnded(false), stop(false), flushRequested(0), flushCompleted(0),
+	snapshotActive(false), dirtyChunkCount(0), loadsInFlight(0)
+{
+}
+
+ChunkStore::~ChunkStore()
+{
+	close();
+}
+
+bool ChunkStore::open(const std::string& saveDirectory, TerrainGenerator* baseGenerator, bool deltaSaves)
+{
+	close();
+
+	std::error_code error;
+	std::filesystem::create_directories(saveDirectory, error);
+	if (error)
+	{
+		std::cerr << "ChunkStore: Failed to create " << saveDirectory << ": " << error.message() << std::endl;
+		return false;
+	}
+
+	directory = saveDirectory;
+	generator = baseGenerator;
+	storeDeltas = deltaSaves;
+	stop = false;
+	ioThread = std::thread(&ChunkStore::ioThreadMain, this);
+	return true;
+}
+
+void ChunkStore::close()
+{
+	if (!ioThread.joinable())
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stop = true;
+	}
+	condition.notify_one();
+	ioThread.join();
+
+	// Left over loads were requested after the last collect, the chunks asking for them are gone
+	finishedLoads.clear();
+	loadsInFlight.store(0, std::memory_order_relaxed);
+	regionFiles.clear();
+	regionFileOrder.clear();
+	missingRegionFiles.clear();
+	readAheadChunks.clear();
+	readAheadOrder.clear();
+}
+
+static ChunkStore::ChunkData copyChunkData(bool uniform, Block uniformBlock, const Block* blocks)
+{
+	ChunkStore::ChunkData data;
+	data.uniform = uniform;
+	data.uniformBlock = uniformBlock;
+	if (!uniform)
+	{
+		data.blocks.assign(blocks, blocks + CHUNK_VOLUME);
+	}
+	return data;
+}
+
+void ChunkStore::requestSave(const Int3& position, bool uniform, Block uniformBlock, const Block* blocks)
+{
+	ChunkData data = copyChunkData(uniform, uniformBlock, blocks);
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		queuedSaves.emplace_back(position, std::move(data));
+	}
+	condition.notify_one();
+}
+
+bool ChunkStore::beginSnapshot(const std::string& snapshotDirectory)
+{
+	if (!ioThread.joinable() || snapshotActive.exchange(true, std::memory_order_acq_rel))
+	{
+		return false;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		queuedSnapshotDirectory = snapshotDirectory;
+		snapshotSaveBoundary = queuedSaves.size();
+		snapshotCaptureEnded = false;
+	}
+	condition.notify_one();
+	return true;
+}
+
+void ChunkStore::addSnapshotChunk(const Int3& position, bool uniform, Block uniformBlock, const Block* blocks)
+{
+	ChunkData data = copyChunkData(uniform, uniformBlock, blocks);
+	std::lock_guard<std::mutex> lock(mutex);
+	queuedSnapshotChunks.emplace_back(position, std::move(data));
+}
+
+void ChunkStore::endSnapshotCapture()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		snapshotCaptureEnded = true;
+	}
+	condition.notify_one();
+}
+
+void ChunkStore::requestLoad(const Int3& position)
+{
+	loadsInFlight.fetch_add(1, std::memory_order_relaxed);
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		queuedLoads.push_back(position);
+	}
+	condition.notify_one();
+}
+
+void ChunkStore::collectLoadResults(std::vector<LoadResult>& results)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	results.swap(finishedLoads);
+	finishedLoads.clear();
+}
+
+void ChunkStore::flush()
+{
+	if (!ioThread.joinable())
+	{
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(mutex);
+	uint64_t target = ++flushRequested;
+	condition.notify_one();
+	flushCondition.wait(lock, [this, target]() { return flushCompleted >= target; });
+}
+
+uint64_t ChunkStore::requestFlush()
+{
+	if (!ioThread.joinable())
+	{
+		return 0;
+	}
+
+	uint64_t target;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		target = ++flushRequested;
+	}
+	condition.notify_one();
+	return target;
+}
+
+bool ChunkStore::isFlushComplete(uint64_t ticket)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return flushCompleted >= ticket;
+}
+
+void ChunkStore::ioThreadMain()
+{
+	Profiler::setThreadName("Chunk I/O thread");
+
+	std::vector<std::pair<Int3, ChunkData>> saves;
+	std::vector<Int3> loads;
+	std::vector<LoadResult> results;
+	std::vector<std::pair<Int3, ChunkData>> snapshotChunks;
+
+	// Later saves of the same chunk replace earlier ones
+	auto addDirtyChunks = [this](std::vector<std::pair<Int3, ChunkData>>::iterator begin, std::vector<std::pair<Int3, ChunkData>>::iterator end)
+		{
+			for (auto it = begin; it != end; ++it)
+			{
+				if (dirtyChunks.empty())
+				{
+					oldestDirtyTime = Clock::now();
+				}
+				dirtyChunks[it->first] = std::move(it->second);
+				readAheadChunks.erase(it->first);
+			}
+		};
+
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true)
+	{
+		// Sleep until there are requests or the oldest dirty chunk is due, a snapshot copies while idle
+		auto hasWork = [this]() { return stop || !queuedSaves.empty() || !queuedLoads.empty() || flushRequested != flushCompleted ||
+			!queuedSnapshotDirectory.empty() || !queuedSnapshotChunks.empty() || (snapshot && snapshotCaptureEnded); };
+		const bool copying = snapshot && !snapshot->regionsToCopy.empty();
+		if (!copying && dirtyChunks.empty())
+		{
+			condition.wait(lock, hasWork);
+		}
+		else if (!copying)
+		{
+			condition.wait_until(lock, oldestDirtyTime + WRITE_BEHIND_DELAY, hasWork);
+		}
+
+		saves.swap(queuedSaves);
+		loads.swap(queuedLoads);
+		snapshotChunks.swap(queuedSnapshotChunks);
+		std::string snapshotDirectory;
+		snapshotDirectory.swap(queuedSnapshotDirectory);
+		const size_t saveBoundary = snapshotDirectory.empty() ? 0 : std::min(snapshotSaveBoundary, saves.size());
+		const bool captureEnded = snapshotCaptureEnded;
+		const bool stopping = stop;
+		const uint64_t flushTarget = flushRequested;
+		lock.unlock();
+
+		// Saves queued before the snapshot began are written first, so the files hold that moment's state
+		if (!snapshotDirectory.empty())
+		{
+			addDirtyChunks(saves.begin(), saves.begin() + saveBoundary);
+			writeDirtyChunks();
+			startSnapshot(snapshotDirectory);
+		}
+		addDirtyChunks(saves.begin() + saveBoundary, saves.end());
+		saves.clear();
+		dirtyChunkCount.store(dirtyChunks.size(), std::memory_order_relaxed);
+
+		if (snapshot)
+		{
+			for (auto& chunk : snapshotChunks)
+			{
+				snapshot->capturedChunks[chunk.first] = std::move(chunk.second);
+			}
+			snapshot->captureEnded = captureEnded;
+		}
+		snapshotChunks.clear();
+
+		results.resize(loads.size());
+		for (size_t i = 0; i < loads.size(); i++)
+		{
+			serveLoad(loads[i], results[i]);
+		}
+		loads.clear();
+
+		bool writeDue = dirtyChunks.size() >= WRITE_BATCH_SIZE || (!dirtyChunks.empty() && Clock::now() - oldestDirtyTime >= WRITE_BEHIND_DELAY);
+		if (writeDue || stopping || flushTarget != flushCompleted)
+		{
+			writeDirtyChunks();
+		}
+
+		// Stopping finishes the copy, chunks the caller didn't hand over by then are missing from it
+		if (snapshot)
+		{
+			while (updateSnapshot() && stopping)
+			{
+			}
+			if (snapshot->regionsToCopy.empty() && (snapshot->captureEnded || stopping))
+			{
+				finishSnapshot();
+			}
+		}
+
+		lock.lock();
+		if (!results.empty())
+		{
+			loadsInFlight.fetch_sub(results.size(), std::memory_order_relaxed);
+			for (LoadResult& result : results)
+			{
+				finishedLoads.push_back(std::move(result));
+			}
+			results.clear();
+		}
+
+		if (flushTarget != flushCompleted)
+		{
+			flushCompleted = flushTarget;
+			flushCondition.notify_all();
+		}
+
+		if (stopping && queuedSaves.empty() && queuedLoads.empty() && !snapshot)
+		{
+			break;
+		}
+	}
+	lock.unlock();
+
+	for (auto& regionFile : regionFiles)
+	{
+		regionFile.second->close();
+	}
+}
+
+void ChunkStore::serveLoad(const Int3& position, LoadResult& result)
+{
+	PROFILE_SCOPE("Chunk store load");
+
+	result.position = position;
+
+	auto dirty = dirtyChunks.find(position);
+	if (dirty != dirtyChunks.end())
+	{
+		result.found = true;
+		result.data = dirty->second;
+		return;
+	}
+
+	auto cached = readAheadChunks.find(position);
+	if (cached != readAheadChunks.end())
+	{
+		result.found = true;
+		result.data = std::move(cached->second);
+		readAheadChunks.erase(cached);
+		return;
+	}
+
+	result.found = readChunk(position, result.data);
+	if (result.found)
+	{
+		readAhead(position);
+	}
+}
+
+// Stored neighbours in the same region file, chunks are loaded around the player so they are requested soon
+void ChunkStore::readAhead(const Int3& position)
+{
+	Int3 regionPosition = RegionFile::getRegionPosition(position);
+	RegionFile* regionFile = getRegionFile(regionPosition, false);
+	if (!regionFile)
+	{
+		return;
+	}
+
+	for (int dx = -1; dx <= 1; dx++)
+	{
+		for (int dy = -1; dy <= 1; dy++)
+		{
+			for (int dz = -1; dz <= 1; dz++)
+			{
+				Int3 neighbor(position.x + dx, position.y + dy, position.z + dz);
+				if (!(RegionFile::getRegionPosition(neighbor) == regionPosition) ||
+					!regionFile->has(RegionFile::getLocalIndex(neighbor)) ||
+					dirtyChunks.count(neighbor) || readAheadChunks.count(neighbor))
+				{
+					continue;
+				}
+
+				ChunkData data;
+				if (readChunk(neighbor, data))
+				{
+					readAheadChunks.emplace(neighbor, std::move(data));
+					readAheadOrder.push_back(neighbor);
+				}
+			}
+		}
+	}
+
+	// Entries may already be consumed, erasing them again is harmless
+	while (readAheadOrder.size() > MAX_READ_AHEAD_CHUNKS)
+	{
+		readAheadChunks.erase(readAheadOrder.front());
+		readAheadOrder.pop_front();
+	}
+}
+
+bool ChunkStore::readChunk(const Int3& position, ChunkData& data)
+{
+	RegionFile* regionFile = getRegionFile(RegionFile::getRegionPosition(position), false);
+	int localIndex = RegionFile::getLocalIndex(position);
+	if (!regionFile || !regionFile->has(localIndex))
+	{
+		return false;
+	}
+
+	static thread_local std::vector<uint8_t> payload;
+	if (!regionFile->read(localIndex, payload))
+	{
+		return false;
+	}
+
+	data.blocks.resize(CHUNK_VOLUME);
+	if (ChunkCodec::isDelta(payload.data(), payload.size()))
+	{
+		// Base from another seed or generator version would put the changes on different terrain
+		ChunkCodec::DeltaStamp stamp;
+		if (!generator || !ChunkCodec::readDeltaStamp(payload.data(), payload.size(), stamp) ||
+			stamp.generatorVersion != TerrainGenerator::GENERATOR_VERSION || stamp.seed != generator->getSeed())
+		{
+			std::cerr << "ChunkStore: Chunk " << position.x << ", " << position.y << ", " << position.z
+				<< " was saved by another generator, regenerating it." << std::endl;
+			return false;
+		}
+
+		generator->generateBaseChunk(position, data.blocks.data());
+		data.uniform = false;
+		if (ChunkCodec::applyDelta(payload.data(), payload.size(), data.blocks.data()))
+		{
+			return true;
+		}
+		std::cerr << "ChunkStore: Damaged chunk " << position.x << ", " << position.y << ", " << position.z << ", regenerating it." << std::endl;
+		return false;
+	}
+
+	if (!ChunkCodec::decode(payload.data(), payload.size(), data.blocks.data(), data.uniform, data.uniformBlock))
+	{
+		std::cerr << "ChunkStore: Damaged chunk " << position.x << ", " << position.y << ", " << position.z << ", regenerating it." << std::endl;
+		return false;
+	}
+	if (data.uniform)
+	{
+		data.blocks.clear();
+	}
+	return true;
+}
+
+// Writes are grouped per region file in table order, each file is flushed once per batch
+void ChunkStore::writeDirtyChunks()
+{
+	if (dirtyChunks.empty())
+	{
+		return;
+	}
+
+	PROFILE_SCOPE("Chunk store write batch");
+
+	// Snapshot keeps the version from before this batch
+	if (snapshot)
+	{
+		for (const auto& pair : dirtyChunks)
+		{
+			Int3 regionPosition = RegionFile::getRegionPosition(pair.first);
+			if (snapshot->regionsToCopy.count(regionPosition))
+			{
+				copyRegionToSnapshot(regionPosition);
+			}
+		}
+	}
+
+	struct WriteEntry
+	{
+		Int3 region;
+		int localIndex;
+		const Int3* position;
+	};
+	std::vector<WriteEntry> entries;
+	entries.reserve(dirtyChunks.size());
+	for (const auto& pair : dirtyChunks)
+	{
+		entries.push_back({ RegionFile::getRegionPosition(pair.first), RegionFile::getLocalIndex(pair.first), &pair.first });
+	}
+	std::sort(entries.begin(), entries.end(), [](const WriteEntry& a, const WriteEntry& b)
+		{
+			if (a.region.x != b.region.x) return a.region.x < b.region.x;
+			if (a.region.y != b.region.y) return a.region.y < b.region.y;
+			if (a.region.z != b.region.z) return a.region.z < b.region.z;
+			return a.localIndex < b.localIndex;
+		});
+
+	std::vector<uint8_t> payload;
+	RegionFile* regionFile = nullptr;
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		const WriteEntry& entry = entries[i];
+		if (i == 0 || !(entry.region == entries[i - 1].region))
+		{
+			if (regionFile)
+			{
+				flushRegionFile(entries[i - 1].region, regionFile);
+			}
+			regionFile = getRegionFile(entry.region, true);
+		}
+		if (!regionFile)
+		{
+			continue;
+		}
+
+		encodeChunk(*entry.position, dirtyChunks[*entry.position], payload);
+		regionFile->write(entry.localIndex, payload.data(), payload.size());
+	}
+	if (regionFile)
+	{
+		flushRegionFile(entries.back().region, regionFile);
+	}
+
+	dirtyChunks.clear();
+	dirtyChunkCount.store(0, std::memory_order_relaxed);
+}
+
+// Full encoding or delta against the generated chunk, whichever is smaller
+void ChunkStore::encodeChunk(const Int3& position, const ChunkData& data, std::vector<uint8_t>& payload)
+{
+	payload.clear();
+	if (data.uniform)
+	{
+		ChunkCodec::encodeUniform(data.uniformBlock, payload);
+		return;
+	}
+	ChunkCodec::encode(data.blocks.data(), payload);
+
+	if (!generator || !storeDeltas)
+	{
+		return;
+	}
+
+	static thread_local Block baseBlocks[CHUNK_VOLUME];
+	static thread_local std::vector<uint8_t> deltaPayload;
+	generator->generateBaseChunk(position, baseBlocks);
+
+	ChunkCodec::DeltaStamp stamp = { TerrainGenerator::GENERATOR_VERSION, generator->getSeed() };
+	deltaPayload.clear();
+	ChunkCodec::encodeDelta(data.blocks.data(), baseBlocks, stamp, deltaPayload);
+	if (deltaPayload.size() < payload.size())
+	{
+		payload.swap(deltaPayload);
+	}
+}
+
+// Rewritten chunks leave their old sectors free until reused, a file that is mostly free space is compacted.
+// Snapshots copy a region before its first write, so compacting never changes a file they still need.
+void ChunkStore::flushRegionFile(const Int3& regionPosition, RegionFile* regionFile)
+{
+	if (!regionFile->flush() || regionFile->getSectorCount() < MIN_COMPACT_SECTORS ||
+		regionFile->getFreeSectorCount() * 2 <= regionFile->getSectorCount())
+	{
+		return;
+	}
+
+	PROFILE_SCOPE("Chunk store compact region");
+	regionFile->compact();
+
+	// Reopened on the next access
+	if (!regionFile->isOpen())
+	{
+		regionFiles.erase(regionPosition);
+		regionFileOrder.remove(regionPosition);
+	}
+}
+
+RegionFile* ChunkStore::getRegionFile(const Int3& regionPosition, bool create)
+{
+	auto it = regionFiles.find(regionPosition);
+	if (it != regionFiles.end())
+	{
+		regionFileOrder.remove(regionPosition);
+		regionFileOrder.push_back(regionPosition);
+		return it->second.get();
+	}
+
+	if (!create && missingRegionFiles.count(regionPosition))
+	{
+		return nullptr;
+	}
+
+	std::string path = directory + "/" + RegionFile::getFileName(regionPosition);
+	if (!create && !std::filesystem::exists(path))
+	{
+		missingRegionFiles.insert(regionPosition);
+		return nullptr;
+	}
+
+	// Least recently used file is closed, which writes its table
+	if (regionFiles.size() >= MAX_OPEN_REGION_FILES)
+	{
+		regionFiles.erase(regionFileOrder.front());
+		regionFileOrder.pop_front();
+	}
+
+	std::unique_ptr<RegionFile> regionFile = std::make_unique<RegionFile>();
+	if (!regionFile->open(path))
+	{
+		return nullptr;
+	}
+	missingRegionFiles.erase(regionPosition);
+
+	RegionFile* result = regionFile.get();
+	regionFiles.emplace(regionPosition, std::move(regionFile));
+	regionFileOrder.push_back(regionPosition);
+	return result;
+}
+
+void ChunkStore::startSnapshot(const std::string& snapshotDirectory)
+{
+	PROFILE_SCOPE("Chunk store start snapshot");
+
+	std::error_code error;
+	std::filesystem::create_directories(snapshotDirectory, error);
+	if (error)
+	{
+		std::cerr << "ChunkStore: Failed to create " << snapshotDirectory << ": " << error.message() << std::endl;
+		snapshotActive.store(false, std::memory_order_release);
+		return;
+	}
+
+	snapshot = std::make_unique<Snapshot>();
+	snapshot->directory = snapshotDirectory;
+
+	// Open files keep their tables in memory until flushed
+	for (auto& regionFile : regionFiles)
+	{
+		regionFile.second->flush();
+	}
+
+	for (const auto& entry : std::filesystem::directory_iterator(directory, error))
+	{
+		Int3 regionPosition;
+		if (entry.is_regular_file() && RegionFile::parseFileName(entry.path().filename().string(), regionPosition))
+		{
+			snapshot->regionsToCopy.insert(regionPosition);
+		}
+	}
+}
+
+void ChunkStore::copyRegionToSnapshot(const Int3& regionPosition)
+{
+	PROFILE_SCOPE("Chunk store copy region");
+
+	snapshot->regionsToCopy.erase(regionPosition);
+
+	std::string fileName = RegionFile::getFileName(regionPosition);
+	std::error_code error;
+	std::filesystem::copy_file(directory + "/" + fileName, snapshot->directory + "/" + fileName,
+		std::filesystem::copy_options::overwrite_existing, error);
+	if (error)
+	{
+		std::cerr << "ChunkStore: Failed to copy " << fileName << " to the snapshot: " << error.message() << std::endl;
+	}
+}
+
+bool ChunkStore::updateSnapshot()
+{
+	if (snapshot->regionsToCopy.empty())
+	{
+		return false;
+	}
+	Int3 regionPosition = *snapshot->regionsToCopy.begin();
+	copyRegionToSnapshot(regionPosition);
+	return true;
+}
+
+// Chunks that were only in memory go on top of the copied files
+void ChunkStore::finishSnapshot()
+{
+	PROFILE_SCOPE("Chunk store finish snapshot");
+
+	std::vector<uint8_t> payload;
+	std::unordered_map<Int3, std::unique_ptr<RegionFile>, Int3Hasher> snapshotFiles;
+	for (const auto& pair : snapshot->capturedChunks)
+	{
+		Int3 regionPosition = RegionFile::getRegionPosition(pair.first);
+		std::unique_ptr<RegionFile>& regionFile = snapshotFiles[regionPosition];
+		if (!regionFile)
+		{
+			regionFile = std::make_unique<RegionFile>();
+			regionFile->open(snapshot->directory + "/" + RegionFile::getFileName(regionPosition));
+		}
+
+		encodeChunk(pair.first, pair.second, payload);
+		regionFile->write(RegionFile::getLocalIndex(pair.first), payload.data(), payload.size());
+	}
+	snapshotFiles.clear();
+
+	std::cout << "ChunkStore: Snapshot written to " << snapshot->directory << "." << std::endl;
+	snapshot.reset();
+	snapshotActive.store(false, std::memory_order_release);
+}
@@ -0,0 +1,146 @@
+#pragma once
+#include "../Block.h"
+#include "../Metrics.h"
+#include "RegionFile.h"
+
+#include "Int3.h"
+
+#include <string>
+#include <vector>
+#include <list>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+
+class TerrainGenerator;
+
+// Chunk persistence on its own I/O thread. The main thread only queues requests and collects finished loads,
+// so disk access never runs on the main thread or in generation workers. Saves are kept in memory and written
+// in batches grouped by region file, loads of chunks still waiting to be written are served from memory.
+// A load also decodes stored neighbours from the same region, which are usually requested next.
+// With a generator, chunks are stored as a delta against its output when that is smaller.
+//
+// Snapshots copy the save directory as it was at the moment beginSnapshot was called, while saving continues.
+// Region files are copied in the background, a file about to be written is copied first. Chunks that only exist
+// in memory at that moment are handed over by the caller and written into the copy last.
+class ChunkStore
+{
+public:
+	struct ChunkData
+	{
+		bool uniform = false;
+		Block uniformBlock = Block::Air;
+		std::vector<Block> blocks; // CHUNK_VOLUME blocks unless uniform
+	};
+
+	struct LoadResult
+	{
+		Int3 position;
+		bool found = false; // Not stored, generate it
+		ChunkData data;
+	};
+private:
+	static constexpr size_t MAX_OPEN_REGION_FILES = 32;
+	static constexpr size_t MIN_COMPACT_SECTORS = 256; // Smaller files aren't worth rewriting
+	static constexpr size_t WRITE_BATCH_SIZE = 256; // Dirty chunks that trigger a write
+	static constexpr size_t MAX_READ_AHEAD_CHUNKS = 1024;
+	static constexpr std::chrono::milliseconds WRITE_BEHIND_DELAY{ 2000 }; // Oldest dirty chunk waits at most this long
+
+	using Clock = std::chrono::steady_clock;
+
+	std::string directory;
+	std::thread ioThread;
+	TerrainGenerator* generator; // Base chunks for deltas, may be null
+	bool storeDeltas; // Otherwise only reads them, saves are encoded on their own
+
+	// Shared with the I/O thread, protected by mutex
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::condition_variable flushCondition;
+	std::vector<std::pair<Int3, ChunkData>> queuedSaves;
+	std::vector<Int3> queuedLoads;
+	std::vector<LoadResult> finishedLoads;
+	std::string queuedSnapshotDirectory; // Empty unless a snapshot starts
+	size_t snapshotSaveBoundary; // Saves queued before the snapshot started, they are part of it
+	std::vector<std::pair<Int3, ChunkData>> queuedSnapshotChunks;
+	bool snapshotCaptureEnded;
+	bool stop;
+	uint64_t flushRequested; // Incremented by flush(), the I/O thread writes everything up to it
+	uint64_t flushCompleted;
+
+	// I/O thread only
+	std::unordered_map<Int3, ChunkData, Int3Hasher> dirtyChunks;
+	Clock::time_point oldestDirtyTime;
+	std::unordered_map<Int3, std::unique_ptr<RegionFile>, Int3Hasher> regionFiles;
+	std::list<Int3> regionFileOrder; // Least recently used first
+	std::unordered_set<Int3, Int3Hasher> missingRegionFiles; // Never written, loads don't touch the disk
+	std::unordered_map<Int3, ChunkData, Int3Hasher> readAheadChunks;
+	std::deque<Int3> readAheadOrder; // Oldest evicted first
+
+	struct Snapshot
+	{
+		std::string directory;
+		std::unordered_set<Int3, Int3Hasher> regionsToCopy; // Existed when the snapshot started, not copied yet
+		std::unordered_map<Int3, ChunkData, Int3Hasher> capturedChunks;
+		bool captureEnded = false;
+	};
+	std::unique_ptr<Snapshot> snapshot;
+	std::atomic<bool> snapshotActive; // From beginSnapshot until the copy is complete
+
+	std::atomic<size_t> dirtyChunkCount;
+	std::atomic<size_t> loadsInFlight;
+
+	void ioThreadMain();
+	void serveLoad(const Int3& position, LoadResult& result);
+	void readAhead(const Int3& position);
+	bool readChunk(const Int3& position, ChunkData& data);
+	void encodeChunk(const Int3& position, const ChunkData& data, std::vector<uint8_t>& payload);
+	void writeDirtyChunks();
+	void flushRegionFile(const Int3& regionPosition, RegionFile* regionFile);
+	void startSnapshot(const std::string& snapshotDirectory);
+	void copyRegionToSnapshot(const Int3& regionPosition);
+	bool updateSnapshot(); // Copies one region file, false once nothing is left to copy
+	void finishSnapshot();
+	RegionFile* getRegionFile(const Int3& regionPosition, bool create);
+public:
+	ChunkStore();
+	~ChunkStore();
+
+	ChunkStore(const ChunkStore&) = delete;
+	ChunkStore& operator=(const ChunkStore&) = delete;
+	ChunkStore(ChunkStore&&) = delete;
+	ChunkStore& operator=(ChunkStore&&) = delete;
+
+	// Creates the directory and starts the I/O thread. The generator must outlive the store.
+	// Computing a delta generates the base chunk on the I/O thread, bulk saves of unedited chunks skip that.
+	bool open(const std::string& saveDirectory, TerrainGenerator* baseGenerator, bool deltaSaves = true);
+	void close(); // Writes everything still queued
+	bool isOpen() const { return ioThread.joinable(); }
+
+	// Main thread. Blocks is CHUNK_VOLUME values, ignored for uniform chunks.
+	void requestSave(const Int3& position, bool uniform, Block uniformBlock, const Block* blocks);
+	void requestLoad(const Int3& position);
+	void collectLoadResults(std::vector<LoadResult>& results);
+
+	// Blocks until every save queued so far is written
+	void flush();
+	// Same without waiting, the ticket completes once every save queued before the call is written
+	uint64_t requestFlush();
+	bool isFlushComplete(uint64_t ticket);
+
+	// False if a snapshot is still being written. Chunks with unsaved changes must be handed over with
+	// addSnapshotChunk, in the state they had when the snapshot began, followed by endSnapshotCapture.
+	bool beginSnapshot(const std::string& snapshotDirectory);
+	void addSnapshotChunk(const Int3& position, bool uniform, Block uniformBlock, const Block* blocks);
+	void endSnapshotCapture();
+	bool isSnapshotActive() const { return snapshotActive.load(std::memory_order_acquire); }
+
+	size_t getDirtyChunkCount() const { return dirtyChunkCount.load(std::memory_order_relaxed); }
+	size_t getLoadsInFlight() const { return loadsInFlight.load(std::memory_order_relaxed); }
+};
@@ -0,0 +1,381 @@
+#include "EditJournal.h"
+
+#include <iostream>
+#include <algorithm>
+#include <filesystem>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+static constexpr uint32_t JOURNAL_BATCH_MAGIC = 0x4E524A56; // "VJRN"
+static constexpr size_t MAX_FREE_BUFFERS = 4;
+static const char JOURNAL_FILE_PREFIX[] = "edits.";
+static const char JOURNAL_FILE_EXTENSION[] = ".vxj";
+
+EditJournal::EditJournal() :
+	currentFileId(0), stop(false), file(nullptr), fileId(0), uncommittedEntryCount(0)
+{
+}
+
+EditJournal::~EditJournal()
+{
+	close();
+}
+
+bool EditJournal::open(const std::string& saveDirectory, std::vector<Entry>& replayEntries)
+{
+	close();
+
+	std::error_code error;
+	std::filesystem::create_directories(saveDirectory, error);
+	if (error)
+	{
+		std::cerr << "EditJournal: Failed to create " << saveDirectory << ": " << error.message() << std::endl;
+		return false;
+	}
+	directory = saveDirectory;
+
+	// edits.<id>.vxj, replayed in id order
+	const std::string prefix = JOURNAL_FILE_PREFIX;
+	const std::string extension = JOURNAL_FILE_EXTENSION;
+	fileIds.clear();
+	for (const auto& entry : std::filesystem::directory_iterator(directory, error))
+	{
+		std::string name = entry.path().filename().string();
+		if (name.size() <= prefix.size() + extension.size() || name.compare(0, prefix.size(), prefix) != 0 ||
+			name.compare(name.size() - extension.size(), extension.size(), extension) != 0)
+		{
+			continue;
+		}
+
+		std::string number = name.substr(prefix.size(), name.size() - prefix.size() - extension.size());
+		if (number.find_first_not_of("0123456789") != std::string::npos)
+		{
+			continue;
+		}
+		fileIds.push_back(std::stoull(number));
+	}
+	std::sort(fileIds.begin(), fileIds.end());
+
+	for (uint64_t id : fileIds)
+	{
+		replayFile(getFilePath(id), replayEntries);
+	}
+	if (!replayEntries.empty())
+	{
+		std::cout << "EditJournal: Replaying " << replayEntries.size() << " edits from " << fileIds.size() << " files." << std::endl;
+	}
+
+	// Two buffers up front, the main thread keeps appending while one is written
+	currentFileId = fileIds.empty() ? 1 : fileIds.back() + 1;
+	currentBuffer = std::make_unique<std::vector<Entry>>();
+	currentBuffer->reserve(BUFFER_ENTRIES);
+	freeBuffers.push_back(std::make_unique<std::vector<Entry>>());
+	freeBuffers.back()->reserve(BUFFER_ENTRIES);
+
+	stop = false;
+	writerThread = std::thread(&EditJournal::writerThreadMain, this);
+	return true;
+}
+
+void EditJournal::close()
+{
+	if (!isOpen())
+	{
+		return;
+	}
+
+	if (!currentBuffer->empty())
+	{
+		submitCurrentBuffer();
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stop = true;
+	}
+	condition.notify_one();
+	writerThread.join();
+
+	currentBuffer.reset();
+	freeBuffers.clear();
+	fileIds.clear();
+}
+
+void EditJournal::update()
+{
+	if (!isOpen() || currentBuffer->empty())
+	{
+		return;
+	}
+
+	if (Clock::now() - currentBufferTime >= COMMIT_INTERVAL)
+	{
+		submitCurrentBuffer();
+	}
+}
+
+uint64_t EditJournal::rotate()
+{
+	if (!currentBuffer->empty())
+	{
+		submitCurrentBuffer();
+	}
+	return ++currentFileId;
+}
+
+void EditJournal::discardBefore(uint64_t id)
+{
+	// Queued behind the batches of the older files, so nothing is written into a deleted file
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		Batch batch;
+		batch.discardBefore = id;
+		queuedBatches.push_back(std::move(batch));
+	}
+	condition.notify_one();
+}
+
+void EditJournal::submitCurrentBuffer()
+{
+	uncommittedEntryCount.fetch_add(currentBuffer->size(), std::memory_order_relaxed);
+
+	std::unique_ptr<std::vector<Entry>> next;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		Batch batch;
+		batch.entries = std::move(currentBuffer);
+		batch.fileId = currentFileId;
+		queuedBatches.push_back(std::move(batch));
+		if (!freeBuffers.empty())
+		{
+			next = std::move(freeBuffers.back());
+			freeBuffers.pop_back();
+		}
+	}
+	condition.notify_one();
+
+	// Only when edits come in faster than the disk takes them
+	if (!next)
+	{
+		next = std::make_unique<std::vector<Entry>>();
+		next->reserve(BUFFER_ENTRIES);
+	}
+	currentBuffer = std::move(next);
+}
+
+// Group commit, every batch queued while the last sync ran is written and synced together
+void EditJournal::writerThreadMain()
+{
+	std::vector<Batch> batches;
+
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true)
+	{
+		condition.wait(lock, [this]() { return stop || !queuedBatches.empty(); });
+		batches.swap(queuedBatches);
+		const bool stopping = stop;
+		lock.unlock();
+
+		size_t committedEntries = 0;
+		bool unsynced = false;
+		for (const Batch& batch : batches)
+		{
+			if (!batch.entries)
+			{
+				// Newer files must be on disk first, they may hold edits replayed from the discarded ones
+				if (unsynced)
+				{
+					syncFile(file);
+					unsynced = false;
+				}
+				discardFiles(batch.discardBefore);
+				continue;
+			}
+
+			unsynced = writeBatch(batch) || unsynced;
+			committedEntries += batch.entries->size();
+		}
+		if (unsynced)
+		{
+			syncFile(file);
+		}
+
+		lock.lock();
+		for (Batch& batch : batches)
+		{
+			if (batch.entries && freeBuffers.size() < MAX_FREE_BUFFERS)
+			{
+				batch.entries->clear();
+				freeBuffers.push_back(std::move(batch.entries));
+			}
+		}
+		batches.clear();
+		uncommittedEntryCount.fetch_sub(committedEntries, std::memory_order_relaxed);
+
+		if (stopping && queuedBatches.empty())
+		{
+			break;
+		}
+	}
+	lock.unlock();
+
+	if (file)
+	{
+		fclose(file);
+		file = nullptr;
+	}
+}
+
+bool EditJournal::writeBatch(const Batch& batch)
+{
+	if (!file || fileId != batch.fileId)
+	{
+		if (file)
+		{
+			syncFile(file);
+			fclose(file);
+		}
+
+		fileId = batch.fileId;
+		file = fopen(getFilePath(fileId).c_str(), "ab");
+		if (!file)
+		{
+			std::cerr << "EditJournal: Failed to open " << getFilePath(fileId) << ", " << batch.entries->size() << " edits aren't journaled." << std::endl;
+			return false;
+		}
+		fseek(file, 0, SEEK_END); // Append mode may report 0 until the first write
+		if (fileIds.empty() || fileIds.back() != fileId)
+		{
+			fileIds.push_back(fileId);
+		}
+	}
+
+	const long batchStart = ftell(file);
+	const std::vector<Entry>& entries = *batch.entries;
+	BatchHeader header = {};
+	header.magic = JOURNAL_BATCH_MAGIC;
+	header.entryCount = static_cast<uint32_t>(entries.size());
+	header.checksum = computeChecksum(entries.data(), entries.size());
+
+	// Flushed per batch, write errors of buffered data only show up here
+	if (fwrite(&header, sizeof(header), 1, file) != 1 ||
+		fwrite(entries.data(), sizeof(Entry), entries.size(), file) != entries.size() ||
+		fflush(file) != 0)
+	{
+		// Replay stops at a damaged batch, so cut the partial batch off before anything is appended after it.
+		// The earlier batches are synced first, the next batch reopens the file.
+		std::cerr << "EditJournal: Failed to write " << getFilePath(fileId) << ", " << entries.size() << " edits aren't journaled." << std::endl;
+		syncFile(file);
+		fclose(file);
+		file = nullptr;
+
+		std::error_code error;
+		if (batchStart >= 0)
+		{
+			std::filesystem::resize_file(getFilePath(fileId), static_cast<uintmax_t>(batchStart), error);
+		}
+		if (batchStart < 0 || error)
+		{
+			std::cerr << "EditJournal: Failed to truncate " << getFilePath(fileId) << ": " << error.message() << std::endl;
+		}
+		return false;
+	}
+	return true;
+}
+
+void EditJournal::discardFiles(uint64_t beforeId)
+{
+	if (file && fileId < beforeId)
+	{
+		fclose(file);
+		file = nullptr;
+	}
+
+	auto end = std::lower_bound(fileIds.begin(), fileIds.end(), beforeId);
+	for (auto it = fileIds.begin(); it != end; ++it)
+	{
+		std::error_code error;
+		std::filesystem::remove(getFilePath(*it), error);
+		if (error)
+		{
+			std::cerr << "EditJournal: Failed to remove " << getFilePath(*it) << ": " << error.message() << std::endl;
+		}
+	}
+	fileIds.erase(fileIds.begin(), end);
+}
+
+std::string EditJournal::getFilePath(uint64_t id) const
+{
+	return directory + "/" + JOURNAL_FILE_PREFIX + std::to_string(id) + JOURNAL_FILE_EXTENSION;
+}
+
+// Stops at the first damaged batch, the tail of the last file is usually cut off by the crash
+bool EditJournal::replayFile(const std::string& path, std::vector<Entry>& entries)
+{
+	FILE* in = fopen(path.c_str(), "rb");
+	if (!in)
+	{
+		std::cerr << "EditJournal: Failed to open " << path << "." << std::endl;
+		return false;
+	}
+
+	bool complete = true;
+	BatchHeader header;
+	while (fread(&header, sizeof(header), 1, in) == 1)
+	{
+		if (header.magic != JOURNAL_BATCH_MAGIC || header.entryCount == 0 || header.entryCount > BUFFER_ENTRIES)
+		{
+			complete = false;
+			break;
+		}
+
+		size_t start = entries.size();
+		entries.resize(start + header.entryCount);
+		if (fread(&entries[start], sizeof(Entry), header.entryCount, in) != header.entryCount ||
+			computeChecksum(&entries[start], header.entryCount) != header.checksum)
+		{
+			entries.resize(start);
+			complete = false;
+			break;
+		}
+	}
+	complete = complete && feof(in);
+	fclose(in);
+
+	if (!complete)
+	{
+		std::cerr << "EditJournal: " << path << " ends with a damaged batch, the edits after it are lost." << std::endl;
+	}
+	return complete;
+}
+
+uint32_t EditJournal::computeChecksum(const Entry* entries, size_t count)
+{
+	const uint8_t* bytes = reinterpret_cast<const uint8_t*>(entries);
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < count * sizeof(Entry); i++)
+	{
+		hash = (hash ^ bytes[i]) * 16777619u;
+	}
+	return hash;
+}
+
+// Commits the file to the disk, not only to the OS cache
+void EditJournal::syncFile(FILE* target)
+{
+	if (!target)
+	{
+		return;
+	}
+
+	fflush(target);
+#ifdef _WIN32
+	_commit(_fileno(target));
+#else
+	fsync(fileno(target));
+#endif
+}
@@ -0,0 +1,127 @@
+#pragma once
+#include "../Block.h"
+
+#include "Int3.h"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+// Append-only log of block edits, so edits made since the last save survive a crash.
+// The main thread appends into a preallocated buffer, a full buffer or one older than COMMIT_INTERVAL is handed
+// to the journal's own thread, which writes every buffer waiting at that moment and syncs the file once.
+// Region files are never touched, the log is replayed on top of them when the save directory is opened.
+//
+// Entries belong to numbered files. rotate() starts a new file, once the edits of the older files are saved
+// elsewhere discardBefore() deletes them.
+class EditJournal
+{
+public:
+	// Written to disk as is
+	struct Entry
+	{
+		int32_t chunkX;
+		int32_t chunkY;
+		int32_t chunkZ;
+		uint16_t index; // getChunkBlockIndex
+		Block oldBlock;
+		Block newBlock;
+	};
+	static_assert(sizeof(Entry) == 16, "Journal entries are stored as 16 bytes");
+private:
+	static constexpr size_t BUFFER_ENTRIES = 1 << 16; // 1 MB, also the largest batch on disk
+	static constexpr std::chrono::milliseconds COMMIT_INTERVAL{ 50 }; // Oldest buffered edit waits at most this long
+
+	using Clock = std::chrono::steady_clock;
+
+	// Every committed batch is preceded by a header, a torn or corrupt batch ends the replay
+	struct BatchHeader
+	{
+		uint32_t magic;
+		uint32_t entryCount;
+		uint32_t checksum;
+		uint32_t reserved;
+	};
+
+	struct Batch
+	{
+		std::unique_ptr<std::vector<Entry>> entries; // Null for a discard request
+		uint64_t fileId = 0;
+		uint64_t discardBefore = 0;
+	};
+
+	std::string directory;
+	std::thread writerThread;
+
+	// Main thread only
+	std::unique_ptr<std::vector<Entry>> currentBuffer; // Null while closed
+	Clock::time_point currentBufferTime; // First entry of the current buffer
+	uint64_t currentFileId;
+
+	// Shared with the writer thread, protected by mutex
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::vector<Batch> queuedBatches;
+	std::vector<std::unique_ptr<std::vector<Entry>>> freeBuffers;
+	bool stop;
+
+	// Writer thread only
+	FILE* file;
+	uint64_t fileId;
+	std::vector<uint64_t> fileIds; // Existing journal files, ascending
+
+	std::atomic<size_t> uncommittedEntryCount;
+
+	void writerThreadMain();
+	void submitCurrentBuffer();
+	bool writeBatch(const Batch& batch);
+	void discardFiles(uint64_t beforeId);
+	std::string getFilePath(uint64_t id) const;
+	bool replayFile(const std::string& path, std::vector<Entry>& entries);
+	static uint32_t computeChecksum(const Entry* entries, size_t count);
+	static void syncFile(FILE* target);
+public:
+	EditJournal();
+	~EditJournal();
+
+	EditJournal(const EditJournal&) = delete;
+	EditJournal& operator=(const EditJournal&) = delete;
+	EditJournal(EditJournal&&) = delete;
+	EditJournal& operator=(EditJournal&&) = delete;
+
+	// Reads the entries of every journal file in the directory in order, new entries go into a new file.
+	// The old files are kept until discarded, the caller appends replayed edits again before that.
+	bool open(const std::string& saveDirectory, std::vector<Entry>& replayEntries);
+	void close(); // Commits everything appended so far
+	bool isOpen() const { return currentBuffer != nullptr; }
+
+	// Main thread. No system calls unless the buffer is full.
+	void append(const Entry& entry)
+	{
+		if (currentBuffer->empty())
+		{
+			currentBufferTime = Clock::now();
+		}
+		currentBuffer->push_back(entry);
+		if (currentBuffer->size() == BUFFER_ENTRIES)
+		{
+			submitCurrentBuffer();
+		}
+	}
+
+	// Main thread, once per update. Commits the buffer once its oldest entry is COMMIT_INTERVAL old.
+	void update();
+
+	// Starts a new file and returns its id. Files before it can be discarded once their edits are saved.
+	uint64_t rotate();
+	void discardBefore(uint64_t id);
+
+	size_t getUncommittedEntryCount() const { return uncommittedEntryCount.load(std::memory_order_relaxed) + (currentBuffer ? currentBuffer->size() : 0); }
+};
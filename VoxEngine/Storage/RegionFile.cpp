@@ -0,0 +1,394 @@
+#include "RegionFile.h"
+
+#include <iostream>
+#include <cstring>
+#include <cstdio>
+
+static const char REGION_MAGIC[8] = { 'V', 'O', 'X', 'R', 'E', 'G', 'N', '\0' };
+
+RegionFile::RegionFile() :
+	tableDirty(false), usedSectorCount(0)
+{
+	memset(table, 0, sizeof(table));
+}
+
+RegionFile::~RegionFile()
+{
+	close();
+}
+
+bool RegionFile::open(const std::string& filePath)
+{
+	close();
+	path = filePath;
+
+	file.open(path, std::ios::in | std::ios::out | std::ios::binary);
+	if (!file.is_open())
+	{
+		// Doesn't exist yet
+		std::ofstream create(path, std::ios::binary);
+		create.close();
+		file.open(path, std::ios::in | std::ios::out | std::ios::binary);
+		if (!file.is_open())
+		{
+			std::cerr << "RegionFile: Failed to open " << path << "." << std::endl;
+			return false;
+		}
+	}
+
+	file.seekg(0, std::ios::end);
+	size_t fileSize = static_cast<size_t>(file.tellg());
+
+	FileHeader header = {};
+	bool valid = fileSize >= HEADER_SECTORS * SECTOR_SIZE;
+	if (valid)
+	{
+		file.seekg(0);
+		file.read(reinterpret_cast<char*>(&header), sizeof(header));
+		file.read(reinterpret_cast<char*>(table), sizeof(table));
+		valid = file.good() && memcmp(header.magic, REGION_MAGIC, sizeof(REGION_MAGIC)) == 0 && header.formatVersion == FORMAT_VERSION;
+	}
+
+	usedSectors.assign(HEADER_SECTORS, true);
+	usedSectorCount = HEADER_SECTORS;
+	pendingFreeEntries.clear();
+
+	if (!valid)
+	{
+		if (fileSize > 0)
+		{
+			std::cerr << "RegionFile: " << path << " isn't a region file, starting empty." << std::endl;
+		}
+		file.clear();
+		memset(table, 0, sizeof(table));
+		tableDirty = true;
+		return writeTable();
+	}
+
+	// Mark sectors of stored records, entries pointing past the end of the file are dropped
+	size_t sectorCount = (fileSize + SECTOR_SIZE - 1) / SECTOR_SIZE;
+	usedSectors.resize(sectorCount, false);
+	for (uint32_t& entry : table)
+	{
+		size_t offset = entry >> 8;
+		size_t count = entry & 0xFF;
+		if (entry == 0)
+		{
+			continue;
+		}
+		if (offset < HEADER_SECTORS || offset + count > sectorCount)
+		{
+			entry = 0;
+			tableDirty = true;
+			continue;
+		}
+		for (size_t i = offset; i < offset + count; i++)
+		{
+			if (!usedSectors[i]) usedSectorCount++;
+			usedSectors[i] = true;
+		}
+	}
+
+	tableDirty = false;
+	return true;
+}
+
+void RegionFile::close()
+{
+	if (file.is_open())
+	{
+		flush();
+		file.close();
+	}
+	memset(table, 0, sizeof(table));
+	usedSectors.clear();
+	pendingFreeEntries.clear();
+	usedSectorCount = 0;
+	tableDirty = false;
+}
+
+uint32_t RegionFile::computeChecksum(const uint8_t* data, size_t size)
+{
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash = (hash ^ data[i]) * 16777619u;
+	}
+	return hash;
+}
+
+// First fit, otherwise grows the file
+size_t RegionFile::allocateSectors(size_t count)
+{
+	size_t runStart = HEADER_SECTORS;
+	size_t runLength = 0;
+	for (size_t i = HEADER_SECTORS; i < usedSectors.size(); i++)
+	{
+		if (usedSectors[i])
+		{
+			runStart = i + 1;
+			runLength = 0;
+			continue;
+		}
+		if (++runLength == count)
+		{
+			break;
+		}
+	}
+	if (runLength < count)
+	{
+		runStart = usedSectors.size() - runLength;
+		usedSectors.resize(runStart + count, false);
+	}
+
+	for (size_t i = runStart; i < runStart + count; i++)
+	{
+		usedSectors[i] = true;
+	}
+	usedSectorCount += count;
+	return runStart;
+}
+
+void RegionFile::freeSectors(uint32_t entry)
+{
+	size_t offset = entry >> 8;
+	size_t count = entry & 0xFF;
+	for (size_t i = offset; i < offset + count; i++)
+	{
+		usedSectors[i] = false;
+	}
+	usedSectorCount -= count;
+}
+
+bool RegionFile::read(int localIndex, std::vector<uint8_t>& payload)
+{
+	uint32_t entry = table[localIndex];
+	if (entry == 0)
+	{
+		return false;
+	}
+
+	size_t offset = entry >> 8;
+	size_t count = entry & 0xFF;
+
+	RecordHeader record;
+	file.seekg(static_cast<std::streamoff>(offset * SECTOR_SIZE));
+	file.read(reinterpret_cast<char*>(&record), sizeof(record));
+	if (!file.good() || sizeof(record) + record.size > count * SECTOR_SIZE)
+	{
+		file.clear();
+		std::cerr << "RegionFile: Damaged record " << localIndex << " in " << path << "." << std::endl;
+		return false;
+	}
+
+	payload.resize(record.size);
+	file.read(reinterpret_cast<char*>(payload.data()), record.size);
+	if (!file.good() || computeChecksum(payload.data(), payload.size()) != record.checksum)
+	{
+		file.clear();
+		std::cerr << "RegionFile: Damaged record " << localIndex << " in " << path << "." << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool RegionFile::write(int localIndex, const uint8_t* payload, size_t size)
+{
+	size_t count = (sizeof(RecordHeader) + size + SECTOR_SIZE - 1) / SECTOR_SIZE;
+	if (count > MAX_RECORD_SECTORS)
+	{
+		std::cerr << "RegionFile: Record of " << size << " bytes is too large." << std::endl;
+		return false;
+	}
+
+	// Old sectors stay reserved until the table no longer points to them
+	size_t offset = allocateSectors(count);
+
+	RecordHeader record = { static_cast<uint32_t>(size), computeChecksum(payload, size) };
+	std::vector<char> buffer(count * SECTOR_SIZE, 0);
+	memcpy(buffer.data(), &record, sizeof(record));
+	memcpy(buffer.data() + sizeof(record), payload, size);
+
+	file.seekp(static_cast<std::streamoff>(offset * SECTOR_SIZE));
+	file.write(buffer.data(), buffer.size());
+	if (!file.good())
+	{
+		file.clear();
+		freeSectors(static_cast<uint32_t>(offset << 8 | count));
+		std::cerr << "RegionFile: Failed to write " << path << "." << std::endl;
+		return false;
+	}
+
+	if (table[localIndex] != 0)
+	{
+		pendingFreeEntries.push_back(table[localIndex]);
+	}
+	table[localIndex] = static_cast<uint32_t>(offset << 8 | count);
+	tableDirty = true;
+	return true;
+}
+
+void RegionFile::remove(int localIndex)
+{
+	if (table[localIndex] == 0)
+	{
+		return;
+	}
+	pendingFreeEntries.push_back(table[localIndex]);
+	table[localIndex] = 0;
+	tableDirty = true;
+}
+
+bool RegionFile::writeTable()
+{
+	FileHeader header = {};
+	memcpy(header.magic, REGION_MAGIC, sizeof(REGION_MAGIC));
+	header.formatVersion = FORMAT_VERSION;
+
+	std::vector<char> buffer(HEADER_SECTORS * SECTOR_SIZE, 0);
+	memcpy(buffer.data(), &header, sizeof(header));
+	memcpy(buffer.data() + sizeof(header), table, sizeof(table));
+
+	file.seekp(0);
+	file.write(buffer.data(), buffer.size());
+	file.flush();
+	if (!file.good())
+	{
+		file.clear();
+		std::cerr << "RegionFile: Failed to write table of " << path << "." << std::endl;
+		return false;
+	}
+	tableDirty = false;
+	return true;
+}
+
+bool RegionFile::flush()
+{
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	if (tableDirty)
+	{
+		// Records are written before the table points to them
+		file.flush();
+		if (!writeTable())
+		{
+			return false;
+		}
+	}
+
+	for (uint32_t entry : pendingFreeEntries)
+	{
+		freeSectors(entry);
+	}
+	pendingFreeEntries.clear();
+	return true;
+}
+
+bool RegionFile::compact()
+{
+	if (!flush())
+	{
+		return false;
+	}
+
+	// Live records in sector order, copied verbatim
+	std::string compactPath = path + ".compact";
+	std::ofstream out(compactPath, std::ios::binary | std::ios::trunc);
+	if (!out.is_open())
+	{
+		std::cerr << "RegionFile: Failed to create " << compactPath << "." << std::endl;
+		return false;
+	}
+
+	uint32_t newTable[REGION_CHUNKS];
+	memset(newTable, 0, sizeof(newTable));
+
+	std::vector<char> buffer(HEADER_SECTORS * SECTOR_SIZE, 0);
+	out.write(buffer.data(), buffer.size());
+
+	size_t nextSector = HEADER_SECTORS;
+	for (int i = 0; i < REGION_CHUNKS; i++)
+	{
+		uint32_t entry = table[i];
+		if (entry == 0)
+		{
+			continue;
+		}
+
+		size_t count = entry & 0xFF;
+		buffer.resize(count * SECTOR_SIZE);
+		file.seekg(static_cast<std::streamoff>((entry >> 8) * SECTOR_SIZE));
+		file.read(buffer.data(), buffer.size());
+		if (!file.good())
+		{
+			// Record at the end of a file that was cut short
+			file.clear();
+			continue;
+		}
+
+		out.write(buffer.data(), buffer.size());
+		newTable[i] = static_cast<uint32_t>(nextSector << 8 | count);
+		nextSector += count;
+	}
+
+	FileHeader header = {};
+	memcpy(header.magic, REGION_MAGIC, sizeof(REGION_MAGIC));
+	header.formatVersion = FORMAT_VERSION;
+	out.seekp(0);
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	out.write(reinterpret_cast<const char*>(newTable), sizeof(newTable));
+	out.close();
+	if (out.fail())
+	{
+		std::cerr << "RegionFile: Failed to write " << compactPath << "." << std::endl;
+		std::remove(compactPath.c_str());
+		return false;
+	}
+
+	// Rename can't replace an existing file everywhere, the old file is kept until the new one is in place
+	std::string filePath = path;
+	std::string oldPath = path + ".old";
+	close();
+	std::remove(oldPath.c_str());
+	if (std::rename(filePath.c_str(), oldPath.c_str()) != 0 || std::rename(compactPath.c_str(), filePath.c_str()) != 0)
+	{
+		std::cerr << "RegionFile: Failed to replace " << filePath << "." << std::endl;
+		std::rename(oldPath.c_str(), filePath.c_str());
+		open(filePath);
+		return false;
+	}
+	std::remove(oldPath.c_str());
+	return open(filePath);
+}
+
+Int3 RegionFile::getRegionPosition(const Int3& chunkPosition)
+{
+	// Arithmetic shift rounds negative coordinates down
+	return Int3(chunkPosition.x >> REGION_SHIFT, chunkPosition.y >> REGION_SHIFT, chunkPosition.z >> REGION_SHIFT);
+}
+
+int RegionFile::getLocalIndex(const Int3& chunkPosition)
+{
+	constexpr int MASK = REGION_SIZE - 1;
+	return (chunkPosition.x & MASK) << (2 * REGION_SHIFT) | (chunkPosition.y & MASK) << REGION_SHIFT | (chunkPosition.z & MASK);
+}
+
+std::string RegionFile::getFileName(const Int3& regionPosition)
+{
+	return "r." + std::to_string(regionPosition.x) + "." + std::to_string(regionPosition.y) + "." + std::to_string(regionPosition.z) + ".vxr";
+}
+
+bool RegionFile::parseFileName(const std::string& fileName, Int3& regionPosition)
+{
+	char suffix[4] = {};
+	int x, y, z;
+	if (std::sscanf(fileName.c_str(), "r.%d.%d.%d.%3s", &x, &y, &z, suffix) != 4 || std::string(suffix) != "vxr")
+	{
+		return false;
+	}
+	regionPosition = Int3(x, y, z);
+	return getFileName(regionPosition) == fileName;
+}
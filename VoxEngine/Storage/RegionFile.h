@@ -0,0 +1,84 @@
+#pragma once
+#include "Int3.h"
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+#include <cstddef>
+
+// 16x16x16 chunks per file. A table of sector ranges follows the file header, chunk records are stored
+// in 256 byte sectors. Rewritten chunks always go to free sectors and the old ones are released only after
+// the table is flushed, so a crash leaves the previous version readable. Not thread safe.
+class RegionFile
+{
+public:
+	static constexpr int REGION_SIZE = 16; // Chunks per axis
+	static constexpr int REGION_SHIFT = 4;
+	static constexpr int REGION_CHUNKS = REGION_SIZE * REGION_SIZE * REGION_SIZE;
+	static constexpr size_t SECTOR_SIZE = 256;
+	static constexpr size_t MAX_RECORD_SECTORS = 255;
+	static constexpr uint32_t FORMAT_VERSION = 1;
+private:
+	struct FileHeader
+	{
+		char magic[8];
+		uint32_t formatVersion;
+		uint32_t reserved;
+	};
+
+	struct RecordHeader
+	{
+		uint32_t size; // Payload bytes
+		uint32_t checksum; // FNV-1a of the payload
+	};
+
+	// Table entry: sector offset << 8 | sector count, 0 if the chunk isn't stored
+	static constexpr size_t HEADER_SECTORS = (sizeof(FileHeader) + REGION_CHUNKS * sizeof(uint32_t) + SECTOR_SIZE - 1) / SECTOR_SIZE;
+
+	std::string path;
+	std::fstream file;
+	uint32_t table[REGION_CHUNKS];
+	bool tableDirty;
+
+	std::vector<bool> usedSectors;
+	std::vector<uint32_t> pendingFreeEntries; // Replaced records, freed after the next table flush
+	size_t usedSectorCount;
+
+	size_t allocateSectors(size_t count);
+	void freeSectors(uint32_t entry);
+	bool writeTable();
+	static uint32_t computeChecksum(const uint8_t* data, size_t size);
+public:
+	RegionFile();
+	~RegionFile();
+
+	RegionFile(const RegionFile&) = delete;
+	RegionFile& operator=(const RegionFile&) = delete;
+	RegionFile(RegionFile&&) = delete;
+	RegionFile& operator=(RegionFile&&) = delete;
+
+	// Creates the file if it doesn't exist
+	bool open(const std::string& filePath);
+	void close();
+	bool isOpen() const { return file.is_open(); }
+
+	// Local index from getLocalIndex. Read returns false if the chunk isn't stored or the record is damaged.
+	bool has(int localIndex) const { return table[localIndex] != 0; }
+	bool read(int localIndex, std::vector<uint8_t>& payload);
+	bool write(int localIndex, const uint8_t* payload, size_t size);
+	void remove(int localIndex);
+
+	// Writes the table, then releases sectors of replaced records
+	bool flush();
+
+	// Rewrites live records without gaps, worth it once most sectors are free
+	bool compact();
+	size_t getSectorCount() const { return usedSectors.size(); }
+	size_t getFreeSectorCount() const { return usedSectors.size() - usedSectorCount; }
+
+	static Int3 getRegionPosition(const Int3& chunkPosition);
+	static int getLocalIndex(const Int3& chunkPosition);
+	static std::string getFileName(const Int3& regionPosition);
+	static bool parseFileName(const std::string& fileName, Int3& regionPosition);
+};
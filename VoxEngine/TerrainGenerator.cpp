@@ -1,15 +1,22 @@
 #include "TerrainGenerator.h"
 
+#include "Chunk.h"
+#include "ChunkRegion.h"
+#include "ColumnDiskCache.h"
 #include "Profiler.h"
 
 #include <iostream>
 #include <cmath>
+#include <climits>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 
 //============================================================================
 //ChunkColumnData
 
 ChunkColumnData::ChunkColumnData() :
-	referenceCount(0)
+	X(0), Z(0), referenceCount(0), ready(false), minHeight(0), maxHeight(0)
 {
 }
 
@@ -20,12 +27,15 @@ ChunkColumnData::~ChunkColumnData()
 void ChunkColumnData::init(int x, int z)
 {
 	X = x; Z = z;
-	referenceCount = 0;
+	ready.store(false, std::memory_order_relaxed);
+	minHeight = 0;
+	maxHeight = 0;
 }
 
 void ChunkColumnData::destroy()
 {
-	referenceCount = 0;
+	referenceCount.store(0, std::memory_order_relaxed);
+	ready.store(false, std::memory_order_relaxed);
 }
 
 //============================================================================
@@ -48,116 +58,1077 @@ void TerrainGenerator::ChunkColumnDataPool::release(std::unique_ptr<ChunkColumnD
 	chunkColumnData->destroy();
 
 	std::lock_guard<std::mutex> lock(poolMutex);
-	pool.push_back(std::move(chunkColumnData));
+	if (pool.size() < maxSize)
+	{
+		pool.push_back(std::move(chunkColumnData));
+	}
+}
+
+void TerrainGenerator::ChunkColumnDataPool::setMaxSize(size_t size)
+{
+	std::lock_guard<std::mutex> lock(poolMutex);
+	maxSize = size;
+	if (pool.size() > maxSize)
+	{
+		pool.resize(maxSize);
+	}
 }
 
 //============================================================================
 //TerrainGenerator
 
-TerrainGenerator& TerrainGenerator::getInstance()
+TerrainGenerator::TerrainGenerator(int seed) :
+	columnCount(0), heightNoiseKey(0),
+	heightNoise(createDefaultHeightNoise()),
+	heightFrequency(0.004f), heightAmplitude(32.0f), baseHeight(0.0f), seed(seed),
+	densityEnabled(true), caveNoise(createDefaultCaveNoise()),
+	caveFrequency(0.02f), caveStrength(1.0f), densityGradient(0.08f), densityResolution(4),
+	biomesEnabled(true), climateNoise(FastNoise::New<FastNoise::Simplex>()), climateFrequency(0.0015f),
+	tunnelNoise(FastNoise::New<FastNoise::Simplex>()), tunnelFrequency(0.012f), tunnelWidth(0.08f)
+{
+}
+
+TerrainGenerator::~TerrainGenerator()
 {
-	static TerrainGenerator instance;
-	return instance;
+}
+
+TerrainGenerator::ColumnShard& TerrainGenerator::getColumnShard(int x, int z)
+{
+	// Neighbouring columns land in different shards
+	uint32_t hash = static_cast<uint32_t>(x) * 0x9E3779B1u ^ static_cast<uint32_t>(z) * 0x85EBCA77u;
+	hash ^= hash >> 16;
+	return columnShards[hash & (COLUMN_SHARD_COUNT - 1)];
 }
 
 const ChunkColumnData* TerrainGenerator::loadChunkColumnData(int x, int z)
 {
 	PROFILE_SCOPE("Load chunk column data");
 
-	std::lock_guard<std::mutex> lock(dataMutex);
-
-	// Check if column already exists
 	Int2 pos(x, z);
-	auto it = chunkColumnData.find(pos);
-	if (it != chunkColumnData.end())
+	ColumnShard& shard = getColumnShard(x, z);
+	std::unique_lock<std::mutex> lock(shard.mutex);
+
+	// Column already exists
+	auto it = shard.columns.find(pos);
+	if (it != shard.columns.end())
 	{
-		it->second->referenceCount++;
-		return it->second.get();
+		ChunkColumnData* column = it->second.get();
+		column->referenceCount.fetch_add(1, std::memory_order_relaxed);
+		lock.unlock();
+
+		// Another thread may still be generating it
+		if (!column->ready.load(std::memory_order_acquire))
+		{
+			PROFILE_SCOPE("Wait for chunk column data");
+			std::lock_guard<std::mutex> initLock(column->initMutex);
+		}
+		return column;
 	}
 
-	// Create column
-	dataMutex.unlock();
-	std::unique_ptr<ChunkColumnData> column = chunkColumnDataPool.acquire();
-	dataMutex.lock();
+	// Create column. Init mutex is taken before the column is visible, so other loaders wait for it.
+	std::unique_ptr<ChunkColumnData> newColumn = shard.pool.acquire();
+	ChunkColumnData* column = newColumn.get();
+	column->init(x, z);
+	column->referenceCount.store(1, std::memory_order_relaxed);
+
+	std::lock_guard<std::mutex> initLock(column->initMutex);
+	shard.columns.emplace(pos, std::move(newColumn));
+	columnCount.fetch_add(1, std::memory_order_relaxed);
+	lock.unlock();
+
+	// Generate without holding the shard mutex
+	initChunkColumnData(column, x, z);
+	column->ready.store(true, std::memory_order_release);
+
+	return column;
+}
 
-	// Check again in case another thread created it while we were acquiring from pool
-	it = chunkColumnData.find(pos);
-	if (it != chunkColumnData.end())
+void TerrainGenerator::setMaxPooledColumns(size_t count)
+{
+	size_t perShard = (count + COLUMN_SHARD_COUNT - 1) / COLUMN_SHARD_COUNT;
+	for (ColumnShard& shard : columnShards)
 	{
-		// Another thread beat us to it, return the column to the pool
-		dataMutex.unlock();
-		chunkColumnDataPool.release(std::move(column));
-		dataMutex.lock();
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		shard.pool.setMaxSize(perShard);
+	}
+}
+
+void TerrainGenerator::releaseChunkColumnData(const ChunkColumnData* column)
+{
+	PROFILE_SCOPE("Release chunk column data");
+
+	// Position is read before dropping the reference, the column can be recycled afterwards
+	Int2 pos(column->X, column->Z);
+	ChunkColumnData* mutableColumn = const_cast<ChunkColumnData*>(column);
+	if (mutableColumn->referenceCount.fetch_sub(1, std::memory_order_acq_rel) != 1)
+	{
+		return;
+	}
+
+	// Last reference, unload unless a loader took a new reference in the meantime
+	ColumnShard& shard = getColumnShard(pos.x, pos.y);
+	std::lock_guard<std::mutex> lock(shard.mutex);
 
-		it->second->referenceCount++;
-		return it->second.get();
+	auto it = shard.columns.find(pos);
+	if (it == shard.columns.end() || it->second->referenceCount.load(std::memory_order_relaxed) != 0)
+	{
+		return;
 	}
 
-	// Move column into the map
-	auto inserted = chunkColumnData.insert(std::make_pair(pos, std::move(column)));
+	std::unique_ptr<ChunkColumnData> columnToRelease = std::move(it->second);
+	shard.columns.erase(it);
+	columnCount.fetch_sub(1, std::memory_order_relaxed);
+	shard.pool.release(std::move(columnToRelease));
+}
 
-	// Init column
-	ChunkColumnData* columnPtr = inserted.first->second.get();
-	initChunkColumnData(columnPtr, x, z);
-	columnPtr->referenceCount = 1;
+bool TerrainGenerator::openColumnDiskCache(const std::string& path, size_t capacity)
+{
+	std::unique_ptr<ColumnDiskCache> cache = std::make_unique<ColumnDiskCache>();
+	if (!cache->open(path, capacity))
+	{
+		return false;
+	}
 
-	return columnPtr;
+	columnDiskCache = std::move(cache);
+	updateColumnFingerprint();
+	return true;
 }
 
-void TerrainGenerator::releaseChunkColumnData(int x, int z)
+void TerrainGenerator::closeColumnDiskCache()
 {
-	PROFILE_SCOPE("Release chunk column data");
+	columnDiskCache.reset();
+}
 
-	std::lock_guard<std::mutex> lock(dataMutex);
+static uint64_t hashCombine(uint64_t hash, uint64_t value)
+{
+	hash ^= value + 0x9E3779B97F4A7C15ull + (hash << 6) + (hash >> 2);
+	return hash;
+}
 
-	Int2 pos(x, z);
-	auto it = chunkColumnData.find(pos);
-	if (it == chunkColumnData.end())
+static uint64_t hashFloat(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
+
+void TerrainGenerator::updateColumnFingerprint()
+{
+	if (!columnDiskCache)
+	{
+		return;
+	}
+
+	uint64_t hash = GENERATOR_VERSION;
+	hash = hashCombine(hash, static_cast<uint32_t>(seed));
+	hash = hashCombine(hash, heightNoiseKey);
+	hash = hashCombine(hash, hashFloat(heightFrequency));
+	hash = hashCombine(hash, hashFloat(heightAmplitude));
+	hash = hashCombine(hash, hashFloat(baseHeight));
+	hash = hashCombine(hash, biomesEnabled);
+	hash = hashCombine(hash, hashFloat(climateFrequency));
+	columnDiskCache->setFingerprint(hash);
+}
+
+void TerrainGenerator::setSeed(int worldSeed)
+{
+	seed = worldSeed;
+	updateColumnFingerprint();
+}
+
+void TerrainGenerator::setHeightNoise(FastNoise::SmartNode<> node, float frequency, float amplitude, float base)
+{
+	// A graph built in code can't be identified across runs, so its columns are only reused within this session
+	static std::atomic<uint64_t> customNodeCounter(0);
+	uint64_t sessionKey = static_cast<uint64_t>(std::chrono::system_clock::now().time_since_epoch().count());
+	heightNoiseKey = hashCombine(sessionKey, customNodeCounter.fetch_add(1, std::memory_order_relaxed)) | 1;
+
+	heightNoise = node;
+	heightFrequency = frequency;
+	heightAmplitude = amplitude;
+	baseHeight = base;
+	updateColumnFingerprint();
+}
+
+bool TerrainGenerator::setHeightNoise(const char* encodedNodeTree, float frequency, float amplitude, float base)
+{
+	FastNoise::SmartNode<> node = FastNoise::NewFromEncodedNodeTree(encodedNodeTree);
+	if (!node)
+	{
+		std::cerr << "TerrainGenerator: Invalid encoded node tree." << std::endl;
+		return false;
+	}
+
+	setHeightNoise(node, frequency, amplitude, base);
+
+	// Encoded graphs are identified by their encoding
+	uint64_t key = 14695981039346656037ull;
+	for (const char* c = encodedNodeTree; *c; c++)
+	{
+		key = (key ^ static_cast<uint8_t>(*c)) * 1099511628211ull;
+	}
+	heightNoiseKey = key & ~1ull;
+	updateColumnFingerprint();
+	return true;
+}
+
+// Plains and ridged mountains blended by a low frequency mask, with fractal domain warp on top
+FastNoise::SmartNode<> TerrainGenerator::createDefaultHeightNoise()
+{
+	auto simplex = FastNoise::New<FastNoise::Simplex>();
+
+	auto plains = FastNoise::New<FastNoise::FractalFBm>();
+	plains->SetSource(simplex);
+	plains->SetOctaveCount(5);
+	plains->SetGain(0.5f);
+	plains->SetLacunarity(2.0f);
+
+	auto mountains = FastNoise::New<FastNoise::FractalRidged>();
+	mountains->SetSource(simplex);
+	mountains->SetOctaveCount(4);
+
+	auto maskScale = FastNoise::New<FastNoise::DomainScale>();
+	maskScale->SetSource(simplex);
+	maskScale->SetScale(0.25f);
+
+	auto mask = FastNoise::New<FastNoise::Remap>();
+	mask->SetSource(maskScale);
+	mask->SetRemap(-1.0f, 1.0f, 0.0f, 1.0f);
+
+	auto blend = FastNoise::New<FastNoise::Fade>();
+	blend->SetA(plains);
+	blend->SetB(mountains);
+	blend->SetFade(mask);
+
+	auto warp = FastNoise::New<FastNoise::DomainWarpGradient>();
+	warp->SetSource(blend);
+	warp->SetWarpAmplitude(0.4f);
+	warp->SetWarpFrequency(0.5f);
+
+	auto fractalWarp = FastNoise::New<FastNoise::DomainWarpFractalProgressive>();
+	fractalWarp->SetSource(warp);
+	fractalWarp->SetOctaveCount(2);
+
+	return fractalWarp;
+}
+
+void TerrainGenerator::setCaveNoise(FastNoise::SmartNode<> node, float frequency, float strength, float gradient)
+{
+	caveNoise = node;
+	caveFrequency = frequency;
+	caveStrength = strength;
+	densityGradient = gradient;
+}
+
+FastNoise::SmartNode<> TerrainGenerator::createDefaultCaveNoise()
+{
+	auto simplex = FastNoise::New<FastNoise::Simplex>();
+
+	auto fractal = FastNoise::New<FastNoise::FractalFBm>();
+	fractal->SetSource(simplex);
+	fractal->SetOctaveCount(3);
+
+	return fractal;
+}
+
+void TerrainGenerator::setDensityEnabled(bool enabled)
+{
+	densityEnabled = enabled;
+}
+
+void TerrainGenerator::setDensityResolution(int resolution)
+{
+	// Sample grid must line up with chunk borders
+	if (resolution <= 0 || CHUNK_SIZE % resolution != 0)
+	{
+		std::cerr << "TerrainGenerator: Density resolution must divide " << CHUNK_SIZE << "." << std::endl;
+		return;
+	}
+	densityResolution = resolution;
+}
+
+void TerrainGenerator::setBiomesEnabled(bool enabled)
+{
+	biomesEnabled = enabled;
+	updateColumnFingerprint();
+}
+
+Biome TerrainGenerator::selectBiome(float temperature, float humidity)
+{
+	if (temperature < -0.35f) return Biome::Tundra;
+	if (temperature > 0.35f && humidity < 0.0f) return Biome::Desert;
+	if (humidity < -0.35f) return Biome::Mountains;
+	if (humidity > 0.25f) return Biome::Forest;
+	return Biome::Plains;
+}
+
+const BiomeParams& TerrainGenerator::getBiomeParams(Biome biome)
+{
+	static const BiomeParams params[static_cast<int>(Biome::Count)] =
+	{
+		// heightScale, heightOffset, surfaceBlock, fillerBlock, treeChance
+		{ 0.6f, 0.0f, Block::Grass, Block::Dirt, 300 },  // Plains
+		{ 0.8f, 4.0f, Block::Grass, Block::Dirt, 40 },   // Forest
+		{ 0.35f, 2.0f, Block::Sand, Block::Sand, 0 },    // Desert
+		{ 2.0f, 18.0f, Block::Grass, Block::Dirt, 400 }, // Mountains
+		{ 0.7f, 0.0f, Block::Snow, Block::Dirt, 200 }    // Tundra
+	};
+	return params[static_cast<int>(biome)];
+}
+
+bool TerrainGenerator::classifyUniformChunk(int chunkY, const ChunkColumnData* column, Block& uniformBlock) const
+{
+	const int bottomY = chunkY * CHUNK_SIZE;
+	const int topY = bottomY + CHUNK_SIZE - 1;
+
+	if (!densityEnabled)
+	{
+		if (bottomY >= column->maxHeight)
+		{
+			uniformBlock = Block::Air;
+			return true;
+		}
+		if (topY < column->minHeight)
+		{
+			uniformBlock = Block::Solid;
+			return true;
+		}
+		return false;
+	}
+
+	// Cave noise (and its trilinear upsampling) stays in [-1, 1], so density is bounded by the height range
+	const float caveBound = std::abs(caveStrength);
+	const float maxDensity = (column->maxHeight - bottomY) * densityGradient + caveBound;
+	const float minDensity = (column->minHeight - topY) * densityGradient - caveBound;
+
+	if (maxDensity <= 0.0f)
+	{
+		uniformBlock = Block::Air;
+		return true;
+	}
+	if (minDensity > 0.0f)
+	{
+		uniformBlock = Block::Solid;
+		return true;
+	}
+	return false;
+}
+
+void TerrainGenerator::generateChunkBlocks(int chunkX, int chunkY, int chunkZ, const ChunkColumnData* column, Block* blocks) const
+{
+	Block uniformBlock;
+	if (classifyUniformChunk(chunkY, column, uniformBlock))
+	{
+		std::fill(blocks, blocks + CHUNK_VOLUME, uniformBlock);
+		return;
+	}
+
+	if (densityEnabled)
+	{
+		float density[CHUNK_VOLUME];
+		generateChunkDensity(chunkX, chunkY, chunkZ, column, density);
+
+		for (int i = 0; i < CHUNK_VOLUME; i++)
+		{
+			blocks[i] = density[i] > 0.0f ? Block::Solid : Block::Air;
+		}
+		return;
+	}
+
+	const int* heightMap = column->heightMap;
+	for (int x = 0; x < CHUNK_SIZE; x++)
+	{
+		for (int z = 0; z < CHUNK_SIZE; z++)
+		{
+			const int globalHeight = heightMap[z + x * CHUNK_SIZE];
+
+			for (int y = 0; y < CHUNK_SIZE; y++)
+			{
+				int worldY = chunkY * CHUNK_SIZE + y;
+				blocks[getChunkBlockIndex(x, y, z)] = worldY < globalHeight ? Block::Solid : Block::Air;
+			}
+		}
+	}
+}
+
+void TerrainGenerator::generateChunkDensity(int chunkX, int chunkY, int chunkZ, const ChunkColumnData* column, float* density) const
+{
+	PROFILE_SCOPE("Generate chunk density");
+
+	generateNoise3D(caveNoise, caveFrequency, seed, chunkX, chunkY, chunkZ, density);
+
+	const int* heightMap = column->heightMap;
+	for (int x = 0; x < CHUNK_SIZE; x++)
+	{
+		for (int y = 0; y < CHUNK_SIZE; y++)
+		{
+			float worldY = static_cast<float>(chunkY * CHUNK_SIZE + y);
+			float* row = density + getChunkBlockIndex(x, y, 0);
+			const int* heightRow = heightMap + x * CHUNK_SIZE;
+
+			// Contiguous in z, so this loop vectorizes
+			for (int z = 0; z < CHUNK_SIZE; z++)
+			{
+				row[z] = (static_cast<float>(heightRow[z]) - worldY) * densityGradient + row[z] * caveStrength;
+			}
+		}
+	}
+}
+
+void TerrainGenerator::generateNoise3D(const FastNoise::SmartNode<>& node, float frequency, int noiseSeed,
+	int chunkX, int chunkY, int chunkZ, float* noise) const
+{
+	// Grid is generated z-major with noise 'x' as world z, matching getChunkBlockIndex
+	if (densityResolution == 1)
 	{
+		node->GenUniformGrid3D(noise,
+			chunkZ * CHUNK_SIZE, chunkY * CHUNK_SIZE, chunkX * CHUNK_SIZE,
+			CHUNK_SIZE, CHUNK_SIZE, CHUNK_SIZE,
+			frequency, noiseSeed);
 		return;
 	}
 
-	// Decrement reference count
-	it->second->referenceCount--;
+	// Reduced resolution, samples include the far border so neighbouring chunks interpolate the same values
+	constexpr int MAX_SAMPLES = CHUNK_SIZE / 2 + 1;
+	const int step = densityResolution;
+	const int samples = CHUNK_SIZE / step + 1;
+	const int cellsPerChunk = CHUNK_SIZE / step;
 
-	// If no more references, unload the column
-	if (it->second->referenceCount <= 0)
+	float grid[MAX_SAMPLES * MAX_SAMPLES * MAX_SAMPLES];
+	node->GenUniformGrid3D(grid,
+		chunkZ * cellsPerChunk, chunkY * cellsPerChunk, chunkX * cellsPerChunk,
+		samples, samples, samples,
+		frequency * step, noiseSeed);
+
+	auto sample = [&](int sx, int sy, int sz)
+		{
+			return grid[sz + (sy + sx * samples) * samples];
+		};
+
+	const float invStep = 1.0f / step;
+	for (int x = 0; x < CHUNK_SIZE; x++)
 	{
-		std::unique_ptr<ChunkColumnData> columnToRelease = std::move(it->second);
-		chunkColumnData.erase(it);
+		int sx = x / step;
+		float fx = (x % step) * invStep;
+		for (int y = 0; y < CHUNK_SIZE; y++)
+		{
+			int sy = y / step;
+			float fy = (y % step) * invStep;
+			for (int z = 0; z < CHUNK_SIZE; z++)
+			{
+				int sz = z / step;
+				float fz = (z % step) * invStep;
+
+				float c00 = sample(sx, sy, sz) + (sample(sx, sy, sz + 1) - sample(sx, sy, sz)) * fz;
+				float c01 = sample(sx, sy + 1, sz) + (sample(sx, sy + 1, sz + 1) - sample(sx, sy + 1, sz)) * fz;
+				float c10 = sample(sx + 1, sy, sz) + (sample(sx + 1, sy, sz + 1) - sample(sx + 1, sy, sz)) * fz;
+				float c11 = sample(sx + 1, sy + 1, sz) + (sample(sx + 1, sy + 1, sz + 1) - sample(sx + 1, sy + 1, sz)) * fz;
+
+				float c0 = c00 + (c01 - c00) * fy;
+				float c1 = c10 + (c11 - c10) * fy;
+
+				noise[getChunkBlockIndex(x, y, z)] = c0 + (c1 - c0) * fx;
+			}
+		}
+	}
+}
 
-		// Release to pool without holding the data mutex
-		dataMutex.unlock();
-		chunkColumnDataPool.release(std::move(columnToRelease));
-		dataMutex.lock();
+//============================================================================
+// Generation stages
+
+// Deterministic per position, so features don't depend on which chunk placed them first
+static uint32_t hashPosition(int x, int y, int z, int seed)
+{
+	uint32_t hash = static_cast<uint32_t>(seed) * 0x27D4EB2Du;
+	hash ^= static_cast<uint32_t>(x) * 0x85EBCA77u;
+	hash ^= static_cast<uint32_t>(y) * 0xC2B2AE3Du;
+	hash ^= static_cast<uint32_t>(z) * 0x165667B1u;
+	hash ^= hash >> 15;
+	hash *= 0x2C1B3C6Du;
+	hash ^= hash >> 12;
+	hash *= 0x297A2D39u;
+	hash ^= hash >> 15;
+	return hash;
+}
+
+int TerrainGenerator::getStageRadius(GenerationStage stage)
+{
+	switch (stage)
+	{
+	case GenerationStage::Terrain: return 0;
+	case GenerationStage::Carve: return 0;
+	case GenerationStage::Surface: return 1;
+	case GenerationStage::Features: return 0;
+	case GenerationStage::Light: return 1;
+	default: return 0;
+	}
+}
+
+const char* TerrainGenerator::getStageName(GenerationStage stage)
+{
+	switch (stage)
+	{
+	case GenerationStage::Terrain: return "Terrain";
+	case GenerationStage::Carve: return "Carve";
+	case GenerationStage::Surface: return "Surface";
+	case GenerationStage::Features: return "Features";
+	case GenerationStage::Light: return "Light";
+	default: return "Unknown";
+	}
+}
+
+void TerrainGenerator::runStage(GenerationStage stage, ChunkRegion& region, std::vector<PendingBlockWrite>& pendingWrites)
+{
+	switch (stage)
+	{
+	case GenerationStage::Terrain: region.getCenter()->buildBlocks(*this); break;
+	case GenerationStage::Carve: carveTunnels(region.getCenter()); break;
+	case GenerationStage::Surface: paintSurface(region); break;
+	case GenerationStage::Features: placeFeatures(region.getCenter(), pendingWrites); break;
+	case GenerationStage::Light: computeLight(region); break;
+	default: break;
+	}
+}
+
+void TerrainGenerator::carveTunnels(Chunk* chunk) const
+{
+	PROFILE_SCOPE("Carve tunnels");
+
+	const ChunkColumnData* column = chunk->getChunkColumnData();
+	const Int3 pos = chunk->getPosition();
+
+	// Tunnels stay below the surface, so chunks above it and air chunks have nothing to carve
+	if (pos.y * CHUNK_SIZE >= column->maxHeight ||
+		(chunk->isUniform() && chunk->getBlock_inBoundaries(0, 0, 0) == Block::Air))
+	{
+		return;
+	}
+
+	float noiseA[CHUNK_VOLUME];
+	float noiseB[CHUNK_VOLUME];
+	generateNoise3D(tunnelNoise, tunnelFrequency, seed + 1, pos.x, pos.y, pos.z, noiseA);
+	generateNoise3D(tunnelNoise, tunnelFrequency, seed + 2, pos.x, pos.y, pos.z, noiseB);
+
+	const int* heightMap = column->heightMap;
+	for (int x = 0; x < CHUNK_SIZE; x++)
+	{
+		for (int y = 0; y < CHUNK_SIZE; y++)
+		{
+			int worldY = pos.y * CHUNK_SIZE + y;
+			for (int z = 0; z < CHUNK_SIZE; z++)
+			{
+				int index = getChunkBlockIndex(x, y, z);
+				if (worldY < heightMap[z + x * CHUNK_SIZE] &&
+					std::abs(noiseA[index]) < tunnelWidth && std::abs(noiseB[index]) < tunnelWidth)
+				{
+					chunk->setBlock_inBoundaries(x, y, z, Block::Air);
+				}
+			}
+		}
+	}
+}
+
+// Blocks Features places into air
+static bool isAirOrFeature(Block block)
+{
+	return block == Block::Air || block == Block::Wood || block == Block::Leaves;
+}
+
+void TerrainGenerator::paintSurface(ChunkRegion& region) const
+{
+	PROFILE_SCOPE("Paint surface");
+
+	constexpr int DIRT_DEPTH = 3;
+	constexpr int MAX_DEPTH_BELOW_SURFACE = 8; // Deep cave floors stay stone
+
+	Chunk* chunk = region.getCenter();
+	const ChunkColumnData* column = chunk->getChunkColumnData();
+	const int chunkWorldY = chunk->getY() * CHUNK_SIZE;
+
+	for (int x = 0; x < CHUNK_SIZE; x++)
+	{
+		for (int z = 0; z < CHUNK_SIZE; z++)
+		{
+			const int height = column->heightMap[z + x * CHUNK_SIZE];
+			const BiomeParams& biome = getBiomeParams(column->biomeMap[z + x * CHUNK_SIZE]);
+
+			// Solid blocks between this block and the closest air above, continued from the chunk above.
+			// Features of the chunk above may already have run, their trees count as air so the result doesn't depend on that.
+			int depth = 0;
+			while (depth <= DIRT_DEPTH && !isAirOrFeature(region.getBlock(x, CHUNK_SIZE + depth, z)))
+			{
+				depth++;
+			}
+
+			for (int y = CHUNK_SIZE - 1; y >= 0; y--)
+			{
+				Block block = chunk->getBlock_inBoundaries(x, y, z);
+				if (block == Block::Air)
+				{
+					depth = 0;
+					continue;
+				}
+
+				if (block == Block::Solid && depth <= DIRT_DEPTH && chunkWorldY + y >= height - MAX_DEPTH_BELOW_SURFACE)
+				{
+					chunk->setBlock_inBoundaries(x, y, z, depth == 0 ? biome.surfaceBlock : biome.fillerBlock);
+				}
+				depth++;
+			}
+		}
+	}
+}
+
+// Features only replace specific blocks: leaves fill air, trunks replace air and leaves, ore replaces stone.
+// The result doesn't depend on the order writes are applied in.
+static Block applyFeatureBlock(Block current, Block feature)
+{
+	switch (feature)
+	{
+	case Block::Leaves: return current == Block::Air ? feature : current;
+	case Block::Wood: return current == Block::Air || current == Block::Leaves ? feature : current;
+	case Block::Ore: return current == Block::Solid ? feature : current;
+	default: return current;
+	}
+}
+
+// Writes inside the chunk are applied directly, writes into other chunks are deferred
+class FeatureWriter
+{
+	Chunk* chunk;
+	Int3 chunkPos;
+	std::vector<PendingBlockWrite>& pendingWrites;
+public:
+	FeatureWriter(Chunk* chunk, std::vector<PendingBlockWrite>& pendingWrites) :
+		chunk(chunk), chunkPos(chunk->getPosition()), pendingWrites(pendingWrites)
+	{
+	}
+
+	void place(int x, int y, int z, Block block)
+	{
+		if ((x & CHUNK_UPPER_BITS_MASK) == 0 && (y & CHUNK_UPPER_BITS_MASK) == 0 && (z & CHUNK_UPPER_BITS_MASK) == 0)
+		{
+			Block current = chunk->getBlock_inBoundaries(x, y, z);
+			Block result = applyFeatureBlock(current, block);
+			if (result != current)
+			{
+				chunk->setBlock_inBoundaries(x, y, z, result);
+			}
+			return;
+		}
+
+		PendingBlockWrite write;
+		write.chunk = Int3(
+			chunkPos.x + (x & CHUNK_UPPER_BITS_MASK) / CHUNK_SIZE,
+			chunkPos.y + (y & CHUNK_UPPER_BITS_MASK) / CHUNK_SIZE,
+			chunkPos.z + (z & CHUNK_UPPER_BITS_MASK) / CHUNK_SIZE);
+		write.index = static_cast<uint16_t>(getChunkBlockIndex(x & CHUNK_LOWER_BITS_MASK, y & CHUNK_LOWER_BITS_MASK, z & CHUNK_LOWER_BITS_MASK));
+		write.block = block;
+		pendingWrites.push_back(write);
+	}
+};
+
+static void placeTree(FeatureWriter& writer, int x, int y, int z, uint32_t hash)
+{
+	const int trunkHeight = 4 + static_cast<int>((hash >> 8) % 3);
+	const int top = y + trunkHeight - 1;
+
+	for (int ly = top - 2; ly <= top + 1; ly++)
+	{
+		const int radius = ly < top ? 2 : 1;
+		for (int dx = -radius; dx <= radius; dx++)
+		{
+			for (int dz = -radius; dz <= radius; dz++)
+			{
+				if (radius == 2 && std::abs(dx) == 2 && std::abs(dz) == 2)
+				{
+					continue; // Round the corners
+				}
+				writer.place(x + dx, ly, z + dz, Block::Leaves);
+			}
+		}
+	}
+
+	for (int ly = y; ly <= top; ly++)
+	{
+		writer.place(x, ly, z, Block::Wood);
+	}
+}
+
+// Reads only this chunk, so it doesn't wait for neighbours
+void TerrainGenerator::placeFeatures(Chunk* chunk, std::vector<PendingBlockWrite>& pendingWrites) const
+{
+	PROFILE_SCOPE("Place features");
+
+	constexpr int ORE_ATTEMPTS = 6;
+	constexpr int ORE_MIN_DEPTH = 6;
+
+	FeatureWriter writer(chunk, pendingWrites);
+	const Int3 pos = chunk->getPosition();
+	const ChunkColumnData* column = chunk->getChunkColumnData();
+	const int* heightMap = column->heightMap;
+
+	// Trees, rooted on the biome's surface inside this chunk, can grow into neighbours.
+	// Roots on the top layer can't see the chunk above and are always accepted.
+	for (int x = 0; x < CHUNK_SIZE; x++)
+	{
+		for (int z = 0; z < CHUNK_SIZE; z++)
+		{
+			const BiomeParams& biome = getBiomeParams(column->biomeMap[z + x * CHUNK_SIZE]);
+			uint32_t hash = hashPosition(pos.x * CHUNK_SIZE + x, 0, pos.z * CHUNK_SIZE + z, seed);
+			if (biome.treeChance == 0 || hash % biome.treeChance != 0)
+			{
+				continue;
+			}
+
+			for (int y = CHUNK_SIZE - 1; y >= 0; y--)
+			{
+				if (chunk->getBlock_inBoundaries(x, y, z) == biome.surfaceBlock &&
+					(y == CHUNK_SIZE - 1 || chunk->getBlock_inBoundaries(x, y + 1, z) == Block::Air))
+				{
+					placeTree(writer, x, y + 1, z, hash);
+					break;
+				}
+			}
+		}
+	}
+
+	// Ore blobs, centered in this chunk
+	for (int i = 0; i < ORE_ATTEMPTS; i++)
+	{
+		uint32_t hash = hashPosition(pos.x, pos.y, pos.z, seed + 1 + i);
+		int x = hash & CHUNK_LOWER_BITS_MASK;
+		int y = (hash >> 4) & CHUNK_LOWER_BITS_MASK;
+		int z = (hash >> 8) & CHUNK_LOWER_BITS_MASK;
+		if (pos.y * CHUNK_SIZE + y > heightMap[z + x * CHUNK_SIZE] - ORE_MIN_DEPTH)
+		{
+			continue;
+		}
+
+		uint32_t shape = hashPosition(x, y, z, static_cast<int>(hash));
+		int bit = 0;
+		for (int dx = -1; dx <= 1; dx++)
+		{
+			for (int dy = -1; dy <= 1; dy++)
+			{
+				for (int dz = -1; dz <= 1; dz++, bit++)
+				{
+					bool center = dx == 0 && dy == 0 && dz == 0;
+					if (center || (shape >> bit) & 1)
+					{
+						writer.place(x + dx, y + dy, z + dz, Block::Ore);
+					}
+				}
+			}
+		}
+	}
+}
+
+void TerrainGenerator::applyPendingWrites(ChunkRegion& region, const std::vector<PendingBlockWrite>& writes) const
+{
+	PROFILE_SCOPE("Apply pending block writes");
+
+	const Int3 center = region.getCenter()->getPosition();
+	const int radius = region.getRadius();
+	for (const PendingBlockWrite& write : writes)
+	{
+		int dx = write.chunk.x - center.x;
+		int dy = write.chunk.y - center.y;
+		int dz = write.chunk.z - center.z;
+		if (std::abs(dx) > radius || std::abs(dy) > radius || std::abs(dz) > radius)
+		{
+			continue;
+		}
+
+		Chunk* chunk = region.getChunk(dx, dy, dz);
+		int x = write.index >> 8;
+		int y = (write.index >> 4) & CHUNK_LOWER_BITS_MASK;
+		int z = write.index & CHUNK_LOWER_BITS_MASK;
+
+		Block current = chunk->getBlock_inBoundaries(x, y, z);
+		Block result = applyFeatureBlock(current, write.block);
+		if (result != current)
+		{
+			chunk->setBlock_inBoundaries(x, y, z, result);
+		}
+	}
+}
+
+void TerrainGenerator::generateBaseChunk(const Int3& position, Block* blocks)
+{
+	PROFILE_SCOPE("Generate base chunk");
+
+	// Surface reads the chunk above, nothing else outside the chunk is needed
+	std::unique_ptr<Chunk> above = std::make_unique<Chunk>();
+	std::unique_ptr<Chunk> center = std::make_unique<Chunk>();
+	Chunk* neighbors[6] = {};
+	above->init(position.x, position.y + 1, position.z, neighbors);
+	neighbors[3] = above.get();
+	center->init(position.x, position.y, position.z, neighbors);
+
+	for (Chunk* chunk : { center.get(), above.get() })
+	{
+		chunk->buildBlocks(*this);
+		carveTunnels(chunk);
+	}
+
+	ChunkRegion region;
+	region.reset(center.get(), 1);
+	region.setChunk(0, 1, 0, above.get());
+	paintSurface(region);
+
+	std::vector<PendingBlockWrite> discardedWrites;
+	placeFeatures(center.get(), discardedWrites);
+
+	if (center->isUniform())
+	{
+		std::fill(blocks, blocks + CHUNK_VOLUME, center->getUniformBlock());
+	}
+	else
+	{
+		std::copy(center->getBlockData(), center->getBlockData() + CHUNK_VOLUME, blocks);
+	}
+
+	center->destroy();
+	above->destroy();
+}
+
+// Sky light flood filled over the chunk and a one block border from its neighbours.
+// Columns are open to the sky if the terrain surface is below the top of the region.
+void TerrainGenerator::computeLight(ChunkRegion& region) const
+{
+	PROFILE_SCOPE("Compute light");
+
+	constexpr int SIZE = CHUNK_SIZE + 2;
+	constexpr int MAX_LIGHT = 15;
+	auto gridIndex = [](int x, int y, int z)
+		{
+			return ((x + 1) * SIZE + (y + 1)) * SIZE + (z + 1);
+		};
+
+	uint8_t light[SIZE * SIZE * SIZE] = {};
+	uint16_t queue[SIZE * SIZE * SIZE];
+	int queueBegin = 0, queueEnd = 0;
+
+	Chunk* chunk = region.getCenter();
+	const int regionTopY = chunk->getY() * CHUNK_SIZE + 2 * CHUNK_SIZE - 1;
+
+	// Seed sky light down each column until the first opaque block
+	for (int x = -1; x <= CHUNK_SIZE; x++)
+	{
+		for (int z = -1; z <= CHUNK_SIZE; z++)
+		{
+			int dx = (x & CHUNK_UPPER_BITS_MASK) / CHUNK_SIZE;
+			int dz = (z & CHUNK_UPPER_BITS_MASK) / CHUNK_SIZE;
+			const int* heightMap = region.getChunk(dx, 0, dz)->getChunkColumnData()->heightMap;
+			if (heightMap[(z & CHUNK_LOWER_BITS_MASK) + (x & CHUNK_LOWER_BITS_MASK) * CHUNK_SIZE] > regionTopY)
+			{
+				continue;
+			}
+
+			for (int y = 2 * CHUNK_SIZE - 1; y >= -1; y--)
+			{
+				if (region.getBlock(x, y, z) != Block::Air)
+				{
+					break;
+				}
+				if (y <= CHUNK_SIZE)
+				{
+					int index = gridIndex(x, y, z);
+					light[index] = MAX_LIGHT;
+					queue[queueEnd++] = static_cast<uint16_t>(index);
+				}
+			}
+		}
+	}
+
+	// Breadth first, every cell is reached first by its brightest path
+	static const int offsets[6] = { -SIZE * SIZE, SIZE * SIZE, -SIZE, SIZE, -1, 1 };
+	while (queueBegin < queueEnd)
+	{
+		int index = queue[queueBegin++];
+		int level = light[index] - 1;
+		if (level <= 0)
+		{
+			continue;
+		}
+
+		int x = index / (SIZE * SIZE) - 1;
+		int y = (index / SIZE) % SIZE - 1;
+		int z = index % SIZE - 1;
+		const int coords[6][3] = { { x - 1, y, z }, { x + 1, y, z }, { x, y - 1, z }, { x, y + 1, z }, { x, y, z - 1 }, { x, y, z + 1 } };
+
+		for (int i = 0; i < 6; i++)
+		{
+			int nx = coords[i][0], ny = coords[i][1], nz = coords[i][2];
+			if (nx < -1 || nx > CHUNK_SIZE || ny < -1 || ny > CHUNK_SIZE || nz < -1 || nz > CHUNK_SIZE)
+			{
+				continue;
+			}
+
+			int neighbor = index + offsets[i];
+			if (light[neighbor] >= level || region.getBlock(nx, ny, nz) != Block::Air)
+			{
+				continue;
+			}
+			light[neighbor] = static_cast<uint8_t>(level);
+			queue[queueEnd++] = static_cast<uint16_t>(neighbor);
+		}
+	}
+
+	uint8_t* chunkLight = chunk->getLightData();
+	for (int x = 0; x < CHUNK_SIZE; x++)
+	{
+		for (int y = 0; y < CHUNK_SIZE; y++)
+		{
+			for (int z = 0; z < CHUNK_SIZE; z++)
+			{
+				chunkLight[getChunkBlockIndex(x, y, z)] = light[gridIndex(x, y, z)];
+			}
+		}
 	}
 }
 
 size_t TerrainGenerator::getChunkColumnDataCount() const
 {
-	std::lock_guard<std::mutex> lock(dataMutex);
-	return chunkColumnData.size();
+	return columnCount.load(std::memory_order_relaxed);
 }
 
 void TerrainGenerator::initChunkColumnData(ChunkColumnData* column, int X, int Z)
 {
 	PROFILE_SCOPE("Init chunk column data");
 
-	column->init(X, Z);
+	if (columnDiskCache && columnDiskCache->load(*column))
+	{
+		return;
+	}
+
+	// Whole column in one SIMD call. Grid is generated z-major, so noise 'x' is world z
+	// and the output already matches heightMap's [z + x * CHUNK_SIZE] layout.
+	float noise[CHUNK_AREA];
+	heightNoise->GenUniformGrid2D(noise, Z * CHUNK_SIZE, X * CHUNK_SIZE, CHUNK_SIZE, CHUNK_SIZE, heightFrequency, seed);
+
+	float heightScale[CHUNK_AREA];
+	float heightOffset[CHUNK_AREA];
+	generateColumnBiomes(X, Z, heightScale, heightOffset, column->biomeMap);
 
 	int* heightMap = column->heightMap;
-	for (int x = 0; x < CHUNK_SIZE; x++)
+	int minHeight = INT_MAX;
+	int maxHeight = INT_MIN;
+	for (int i = 0; i < CHUNK_AREA; i++)
 	{
-		int globalX = x + X * CHUNK_SIZE;
-		for (int z = 0; z < CHUNK_SIZE; z++)
+		int height = static_cast<int>(floorf(baseHeight + heightOffset[i] + noise[i] * heightAmplitude * heightScale[i]));
+		heightMap[i] = height;
+		minHeight = std::min(minHeight, height);
+		maxHeight = std::max(maxHeight, height);
+	}
+	column->minHeight = minHeight;
+	column->maxHeight = maxHeight;
+
+	if (columnDiskCache)
+	{
+		columnDiskCache->store(*column);
+	}
+}
+
+// Climate is sampled every BIOME_CELL blocks on a world aligned grid, so neighbouring columns agree on their borders.
+// Height parameters get a separable box blur over the coarse samples and are bilinearly interpolated per block.
+void TerrainGenerator::generateColumnBiomes(int X, int Z, float* heightScale, float* heightOffset, Biome* biomeMap) const
+{
+	PROFILE_SCOPE("Generate column biomes");
+
+	if (!biomesEnabled)
+	{
+		std::fill(heightScale, heightScale + CHUNK_AREA, 1.0f);
+		std::fill(heightOffset, heightOffset + CHUNK_AREA, 0.0f);
+		std::fill(biomeMap, biomeMap + CHUNK_AREA, Biome::Plains);
+		return;
+	}
+
+	constexpr int BIOME_CELL = 4;
+	constexpr int CELLS = CHUNK_SIZE / BIOME_CELL;
+	constexpr int BLEND_RADIUS = 2; // In cells
+	constexpr int BLEND_WIDTH = 2 * BLEND_RADIUS + 1;
+	constexpr int POINTS = CELLS + 1; // Cell corners covering the column
+	constexpr int SAMPLES = POINTS + 2 * BLEND_RADIUS;
+
+	// Same z-major layout as the height map
+	float temperature[SAMPLES * SAMPLES];
+	float humidity[SAMPLES * SAMPLES];
+	const int startX = X * CELLS - BLEND_RADIUS;
+	const int startZ = Z * CELLS - BLEND_RADIUS;
+	climateNoise->GenUniformGrid2D(temperature, startZ, startX, SAMPLES, SAMPLES, climateFrequency * BIOME_CELL, seed + 10);
+	climateNoise->GenUniformGrid2D(humidity, startZ, startX, SAMPLES, SAMPLES, climateFrequency * BIOME_CELL, seed + 11);
+
+	float sampleScale[SAMPLES * SAMPLES];
+	float sampleOffset[SAMPLES * SAMPLES];
+	for (int i = 0; i < SAMPLES * SAMPLES; i++)
+	{
+		const BiomeParams& params = getBiomeParams(selectBiome(temperature[i], humidity[i]));
+		sampleScale[i] = params.heightScale;
+		sampleOffset[i] = params.heightOffset;
+	}
+
+	// Blur along z, then along x
+	float scaleZ[SAMPLES * POINTS];
+	float offsetZ[SAMPLES * POINTS];
+	for (int sx = 0; sx < SAMPLES; sx++)
+	{
+		for (int pz = 0; pz < POINTS; pz++)
+		{
+			float scale = 0.0f, offset = 0.0f;
+			for (int k = 0; k < BLEND_WIDTH; k++)
+			{
+				scale += sampleScale[(pz + k) + sx * SAMPLES];
+				offset += sampleOffset[(pz + k) + sx * SAMPLES];
+			}
+			scaleZ[pz + sx * POINTS] = scale / BLEND_WIDTH;
+			offsetZ[pz + sx * POINTS] = offset / BLEND_WIDTH;
+		}
+	}
+
+	float scalePoints[POINTS * POINTS];
+	float offsetPoints[POINTS * POINTS];
+	for (int px = 0; px < POINTS; px++)
+	{
+		for (int pz = 0; pz < POINTS; pz++)
 		{
-			int globalZ = z + Z * CHUNK_SIZE;
+			float scale = 0.0f, offset = 0.0f;
+			for (int k = 0; k < BLEND_WIDTH; k++)
+			{
+				scale += scaleZ[pz + (px + k) * POINTS];
+				offset += offsetZ[pz + (px + k) * POINTS];
+			}
+			scalePoints[pz + px * POINTS] = scale / BLEND_WIDTH;
+			offsetPoints[pz + px * POINTS] = offset / BLEND_WIDTH;
+		}
+	}
 
-			float v = (sinf(globalX * 0.1f) + sinf(globalZ * 0.1f)) * 0.5f;
+	auto bilinear = [](const float* grid, int stride, int cx, int cz, float fx, float fz)
+		{
+			float a = grid[cz + cx * stride] + (grid[cz + 1 + cx * stride] - grid[cz + cx * stride]) * fz;
+			float b = grid[cz + (cx + 1) * stride] + (grid[cz + 1 + (cx + 1) * stride] - grid[cz + (cx + 1) * stride]) * fz;
+			return a + (b - a) * fx;
+		};
 
-			int height = v * 10.0f;
+	// Per block: blended height parameters, and the biome of the interpolated climate
+	const float* temperatureCorners = temperature + BLEND_RADIUS + BLEND_RADIUS * SAMPLES;
+	const float* humidityCorners = humidity + BLEND_RADIUS + BLEND_RADIUS * SAMPLES;
+	for (int x = 0; x < CHUNK_SIZE; x++)
+	{
+		int cx = x / BIOME_CELL;
+		float fx = static_cast<float>(x % BIOME_CELL) / BIOME_CELL;
+		for (int z = 0; z < CHUNK_SIZE; z++)
+		{
+			int cz = z / BIOME_CELL;
+			float fz = static_cast<float>(z % BIOME_CELL) / BIOME_CELL;
 
-			heightMap[z + x * CHUNK_SIZE] = height;
+			int index = z + x * CHUNK_SIZE;
+			heightScale[index] = bilinear(scalePoints, POINTS, cx, cz, fx, fz);
+			heightOffset[index] = bilinear(offsetPoints, POINTS, cx, cz, fx, fz);
+			biomeMap[index] = selectBiome(
+				bilinear(temperatureCorners, SAMPLES, cx, cz, fx, fz),
+				bilinear(humidityCorners, SAMPLES, cx, cz, fx, fz));
 		}
 	}
 }
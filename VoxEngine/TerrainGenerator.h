@@ -1,18 +1,54 @@
 #pragma once
 #include "Metrics.h"
+#include "Block.h"
+#include "Biome.h"
 
 #include "Int2.h"
+#include "Int3.h"
+
+#include <FastNoise/FastNoise.h>
 
 #include <unordered_map>
+#include <string>
 #include <memory>
 #include <mutex>
+#include <atomic>
+#include <cstdint>
+
+class Chunk;
+class ChunkRegion;
+class ColumnDiskCache;
+
+// Stages run in order. A stage starts on a chunk once every chunk within its radius finished the previous stage.
+enum class GenerationStage : int
+{
+	Terrain,  // Density shape, radius 0
+	Carve,    // Tunnels, radius 0
+	Surface,  // Grass and dirt, reads the chunk above, radius 1
+	Features, // Trees and ores, writes into neighbours through PendingBlockWrite, radius 0
+	Light,    // Applies pending writes, then sky light, reads neighbours, radius 1
+	Count
+};
+
+// Block a feature placed outside its own chunk. Applied once the target chunk's region reaches the Light stage,
+// which waits for every neighbour's Features stage.
+struct PendingBlockWrite
+{
+	Int3 chunk; // Target chunk position
+	uint16_t index; // getChunkBlockIndex inside the target
+	Block block;
+};
 
 struct ChunkColumnData
 {
 	int X, Z; // Coordinates in chunk space
-	uint32_t referenceCount;
+	std::atomic<uint32_t> referenceCount; // Incremented only under the shard mutex
+	std::atomic<bool> ready; // Set once the data below is generated
+	std::mutex initMutex; // Held by the generating thread, other loaders of this column wait on it
 
 	int heightMap[CHUNK_AREA];
+	int minHeight, maxHeight; // Bounds of heightMap, used to skip chunks above or below the surface
+	Biome biomeMap[CHUNK_AREA]; // Same layout as heightMap
 public:
 	ChunkColumnData();
 	~ChunkColumnData();
@@ -27,6 +63,7 @@ class TerrainGenerator
 	{
 		std::vector<std::unique_ptr<ChunkColumnData>> pool;
 		std::mutex poolMutex;
+		size_t maxSize = SIZE_MAX; // Released columns beyond this are freed
 	public:
 		ChunkColumnDataPool() = default;
 		~ChunkColumnDataPool() = default;
@@ -39,28 +76,123 @@ class TerrainGenerator
 		std::unique_ptr<ChunkColumnData> acquire();
 
 		void release(std::unique_ptr<ChunkColumnData> chunkColumnData);
+		void setMaxSize(size_t size);
+	};
+
+	// Column cache is split into shards, so workers only contend on columns that hash to the same shard
+	static constexpr size_t COLUMN_SHARD_COUNT = 64;
+	struct alignas(64) ColumnShard
+	{
+		std::mutex mutex; // Protects columns
+		std::unordered_map<Int2, std::unique_ptr<ChunkColumnData>, Int2Hasher> columns;
+		ChunkColumnDataPool pool;
 	};
 
-	ChunkColumnDataPool chunkColumnDataPool;
-	std::unordered_map<Int2, std::unique_ptr<ChunkColumnData>, Int2Hasher> chunkColumnData;
-	mutable std::mutex dataMutex; // Protects chunkColumnData map
+	ColumnShard columnShards[COLUMN_SHARD_COUNT];
+	std::atomic<size_t> columnCount;
+
+	// Optional, checked before generating a column. Records carry a fingerprint of every setting that changes column output.
+	std::unique_ptr<ColumnDiskCache> columnDiskCache;
+	uint64_t heightNoiseKey; // Identifies the height noise graph in the fingerprint
+
+	// Height noise graph, set before generation starts. Output in [-1, 1] is scaled by heightAmplitude.
+	FastNoise::SmartNode<> heightNoise;
+	float heightFrequency;
+	float heightAmplitude;
+	float baseHeight;
+	int seed; // World seed, every noise and feature hash derives from it
+
+	// 3D density: (height - y) * densityGradient + caveNoise * caveStrength, solid above 0
+	bool densityEnabled;
+	FastNoise::SmartNode<> caveNoise;
+	float caveFrequency;
+	float caveStrength;
+	float densityGradient;
+	int densityResolution; // Sample spacing in blocks, 1 is full resolution, otherwise trilinear upsampling
+
+	// Temperature and humidity select biomes. Biome height parameters are blended on a coarse grid
+	// with a separable box filter, then interpolated per block.
+	bool biomesEnabled;
+	FastNoise::SmartNode<> climateNoise;
+	float climateFrequency;
+
+	// Tunnels are carved where two noise fields are both near zero
+	FastNoise::SmartNode<> tunnelNoise;
+	float tunnelFrequency;
+	float tunnelWidth;
 public:
-	TerrainGenerator() = default;
-	~TerrainGenerator() = default;
+	// Bump whenever generation code changes its output, invalidates persisted columns
+	static constexpr uint32_t GENERATOR_VERSION = 1;
+
+	// Each world owns its generator and column cache
+	explicit TerrainGenerator(int seed);
+	~TerrainGenerator();
 
 	TerrainGenerator(const TerrainGenerator& other) = delete;
 	TerrainGenerator& operator=(const TerrainGenerator& other) = delete;
 	TerrainGenerator(TerrainGenerator&& other) = delete;
 	TerrainGenerator& operator=(TerrainGenerator&& other) = delete;
 
-	static TerrainGenerator& getInstance();
-
+	// Thread safe. Loading a column that is being generated waits for it, release is lock free unless it was the last reference.
 	const ChunkColumnData* loadChunkColumnData(int x, int z);
-	void releaseChunkColumnData(int x, int z);
+	void releaseChunkColumnData(const ChunkColumnData* column);
+	void setMaxPooledColumns(size_t count); // Unused columns kept for reuse, split between shards
+
+	// Persistent column cache, open before generation starts. Capacity in columns.
+	bool openColumnDiskCache(const std::string& path, size_t capacity);
+	void closeColumnDiskCache();
+	const ColumnDiskCache* getColumnDiskCache() const { return columnDiskCache.get(); }
+
+	// Set before generating, cached columns keep the old seed's data
+	void setSeed(int worldSeed);
+	int getSeed() const { return seed; }
+
+	// Noise graph
+	void setHeightNoise(FastNoise::SmartNode<> node, float frequency, float amplitude, float base);
+	bool setHeightNoise(const char* encodedNodeTree, float frequency, float amplitude, float base); // Encoded by NoiseTool
+	static FastNoise::SmartNode<> createDefaultHeightNoise();
+
+	void setCaveNoise(FastNoise::SmartNode<> node, float frequency, float strength, float gradient);
+	static FastNoise::SmartNode<> createDefaultCaveNoise();
+	void setDensityEnabled(bool enabled);
+	void setDensityResolution(int resolution); // 1, 2, 4, 8 or 16
+	bool isDensityEnabled() const { return densityEnabled; }
+
+	// Biomes
+	void setBiomesEnabled(bool enabled);
+	bool isBiomesEnabled() const { return biomesEnabled; }
+	static Biome selectBiome(float temperature, float humidity); // Climate values in [-1, 1]
+	static const BiomeParams& getBiomeParams(Biome biome);
+
+	// Chunk generation, thread safe. Output is CHUNK_VOLUME values in getChunkBlockIndex order.
+	bool classifyUniformChunk(int chunkY, const ChunkColumnData* column, Block& uniformBlock) const; // True if all blocks are 'uniformBlock'
+	void generateChunkBlocks(int chunkX, int chunkY, int chunkZ, const ChunkColumnData* column, Block* blocks) const;
+	void generateChunkDensity(int chunkX, int chunkY, int chunkZ, const ChunkColumnData* column, float* density) const;
+
+	// Generation stages. Thread safe as long as regions of concurrent calls don't overlap.
+	static int getStageRadius(GenerationStage stage);
+	static const char* getStageName(GenerationStage stage);
+	void runStage(GenerationStage stage, ChunkRegion& region, std::vector<PendingBlockWrite>& pendingWrites); // Features output
+	void applyPendingWrites(ChunkRegion& region, const std::vector<PendingBlockWrite>& writes) const;
+
+	// Chunk as its own stages up to Features produce it, without features of its neighbours.
+	// Thread safe, reference that stored chunk deltas are taken against.
+	void generateBaseChunk(const Int3& position, Block* blocks);
 
 	// Debug
 	size_t getChunkColumnDataCount() const;
 private:
+	ColumnShard& getColumnShard(int x, int z);
+	void updateColumnFingerprint();
 	void initChunkColumnData(ChunkColumnData* column, int X, int Z);
+	void generateColumnBiomes(int X, int Z, float* heightScale, float* heightOffset, Biome* biomeMap) const;
+
+	void generateNoise3D(const FastNoise::SmartNode<>& node, float frequency, int noiseSeed,
+		int chunkX, int chunkY, int chunkZ, float* noise) const;
+
+	void carveTunnels(Chunk* chunk) const;
+	void paintSurface(ChunkRegion& region) const;
+	void placeFeatures(Chunk* chunk, std::vector<PendingBlockWrite>& pendingWrites) const;
+	void computeLight(ChunkRegion& region) const;
 };
 
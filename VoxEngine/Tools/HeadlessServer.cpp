@@ -0,0 +1,194 @@
+#include "HeadlessServer.h"
+
+#include "../World.h"
+#include "ThreadPool.h"
+#include "Profiler.h"
+
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cstdlib>
+#include <cmath>
+#include <csignal>
+#include <chrono>
+#include <thread>
+#include <random>
+#include <atomic>
+
+constexpr double REPORT_INTERVAL = 5.0; // Seconds
+constexpr int EDIT_RADIUS = 8; // Blocks around the player
+
+static std::atomic<bool> stopRequested(false);
+
+static void handleStopSignal(int)
+{
+	stopRequested.store(true, std::memory_order_relaxed);
+}
+
+struct VirtualPlayer
+{
+	float x, y, z;
+	float directionX, directionZ;
+	float editBudget = 0.0f;
+	std::mt19937 random;
+};
+
+bool HeadlessServer::run(const Settings& settings)
+{
+	if (settings.playerCount == 0 || settings.tickRate <= 0.0f)
+	{
+		std::cerr << "HeadlessServer: Needs at least one player and a positive tick rate." << std::endl;
+		return false;
+	}
+
+	ThreadPool& pool = ParallelUtils::getGlobalThreadPool();
+	World world(pool, settings.seed, false);
+	if (!settings.columnCachePath.empty())
+	{
+		world.getGenerator().openColumnDiskCache(settings.columnCachePath, 1 << 15);
+	}
+	if (!settings.saveDirectory.empty() && !world.openSaveDirectory(settings.saveDirectory))
+	{
+		return false;
+	}
+
+	// Same spawn as the windowed player, seeded per player so runs are repeatable
+	const float pi = 3.14159265f;
+	std::vector<VirtualPlayer> players(settings.playerCount);
+	for (size_t i = 0; i < players.size(); i++)
+	{
+		float angle = 2.0f * pi * i / players.size();
+		players[i].x = 0.0f;
+		players[i].y = 2.0f;
+		players[i].z = 0.0f;
+		players[i].directionX = std::cos(angle);
+		players[i].directionZ = std::sin(angle);
+		players[i].random.seed(static_cast<uint32_t>(settings.seed + i));
+	}
+
+	std::cout << "\n=== HEADLESS SERVER, " << players.size() << " PLAYERS, " << settings.tickRate << " TICKS/S, "
+		<< pool.getThreadCount() << " THREADS ===\n";
+
+	stopRequested.store(false, std::memory_order_relaxed);
+	std::signal(SIGINT, handleStopSignal);
+	Profiler::setThreadName("Server thread");
+	Profiler::setHitchCapture(50.0, 3.0);
+
+	using Clock = std::chrono::steady_clock;
+	const float tickSeconds = 1.0f / settings.tickRate;
+	const auto tickDuration = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(tickSeconds));
+	const auto start = Clock::now();
+	auto nextTick = start;
+	auto lastReport = start;
+
+	uint64_t tickCount = 0;
+	uint64_t intervalTicks = 0;
+	uint64_t overrunTicks = 0;
+	uint64_t editCount = 0;
+	double intervalTickTime = 0.0;
+	double intervalMaxTickTime = 0.0;
+
+	std::vector<Int3> playerChunks(players.size());
+	std::uniform_int_distribution<int> offset(-EDIT_RADIUS, EDIT_RADIUS);
+	while (!stopRequested.load(std::memory_order_relaxed))
+	{
+		const auto tickStart = Clock::now();
+		if (settings.durationSeconds > 0.0 && std::chrono::duration<double>(tickStart - start).count() >= settings.durationSeconds)
+		{
+			break;
+		}
+
+		Profiler::beginFrame();
+
+		for (size_t i = 0; i < players.size(); i++)
+		{
+			VirtualPlayer& player = players[i];
+			player.x += player.directionX * settings.playerSpeed * tickSeconds;
+			player.z += player.directionZ * settings.playerSpeed * tickSeconds;
+			playerChunks[i] = Int3(
+				static_cast<int>(std::floor(player.x / CHUNK_SIZE)),
+				static_cast<int>(std::floor(player.y / CHUNK_SIZE)),
+				static_cast<int>(std::floor(player.z / CHUNK_SIZE)));
+		}
+
+		world.loadChunksAroundPlayers(playerChunks, settings.renderDistance);
+		world.updateGeneration();
+
+		// Toggles blocks near the player, edits into chunks that aren't generated yet are refused
+		for (VirtualPlayer& player : players)
+		{
+			player.editBudget += settings.editsPerSecond * tickSeconds;
+			for (; player.editBudget >= 1.0f; player.editBudget -= 1.0f)
+			{
+				Int3 position(
+					static_cast<int>(std::floor(player.x)) + offset(player.random),
+					static_cast<int>(std::floor(player.y)) + offset(player.random),
+					static_cast<int>(std::floor(player.z)) + offset(player.random));
+				Block block = world.getBlock(position) == Block::Air ? Block::Solid : Block::Air;
+				if (world.setBlock(position, block))
+				{
+					editCount++;
+				}
+			}
+		}
+
+		Profiler::endFrame();
+
+		const auto tickEnd = Clock::now();
+		double tickTime = std::chrono::duration<double, std::milli>(tickEnd - tickStart).count();
+		tickCount++;
+		intervalTicks++;
+		intervalTickTime += tickTime;
+		intervalMaxTickTime = std::max(intervalMaxTickTime, tickTime);
+
+		if (std::chrono::duration<double>(tickEnd - lastReport).count() >= REPORT_INTERVAL)
+		{
+			std::cout << "Tick " << std::setw(7) << tickCount << ": " << std::fixed << std::setprecision(2)
+				<< intervalTickTime / intervalTicks << " ms avg, " << intervalMaxTickTime << " ms max, "
+				<< overrunTicks << " overruns, " << world.getLoadedChunkCount() << " chunks, "
+				<< world.getGenerationTasksInFlight() << " tasks, " << editCount << " edits" << std::endl;
+			lastReport = tickEnd;
+			intervalTicks = 0;
+			intervalTickTime = 0.0;
+			intervalMaxTickTime = 0.0;
+		}
+
+		// Late ticks run back to back once, then the schedule restarts instead of catching up
+		nextTick += tickDuration;
+		if (tickEnd > nextTick)
+		{
+			overrunTicks++;
+			nextTick = tickEnd;
+		}
+		else
+		{
+			std::this_thread::sleep_until(nextTick);
+		}
+	}
+
+	std::signal(SIGINT, SIG_DFL);
+	Profiler::shutdown();
+	double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	std::cout << "Stopped after " << tickCount << " ticks in " << std::fixed << std::setprecision(1) << seconds << " s, "
+		<< overrunTicks << " overruns, " << editCount << " edits. Saving." << std::endl;
+	return true;
+}
+
+int HeadlessServer::runFromArguments(int argc, char** argv)
+{
+	Settings settings;
+	if (argc >= 1)
+	{
+		settings.playerCount = static_cast<size_t>(std::max(1, std::atoi(argv[0])));
+	}
+	if (argc >= 2)
+	{
+		settings.durationSeconds = std::atof(argv[1]);
+	}
+	if (argc >= 3)
+	{
+		settings.saveDirectory = argv[2];
+	}
+
+	return run(settings) ? 0 : 1;
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <string>
+#include <cstddef>
+
+// Runs the world tick loop without a window or OpenGL context, for dedicated servers and performance runs
+// on machines without a GPU. Virtual players walk away from spawn in evenly spread directions, load chunks
+// around them and edit blocks near them. Ctrl+C stops the loop and saves the world.
+// Runs without a window: VoxEngine --server [players] [seconds] [directory]
+class HeadlessServer
+{
+public:
+	struct Settings
+	{
+		int seed = 1337;
+		size_t playerCount = 1;
+		int renderDistance = 8;
+		float tickRate = 20.0f; // Same as the windowed world update
+		double durationSeconds = 0.0; // 0 runs until interrupted
+		float playerSpeed = 8.0f; // Blocks per second
+		float editsPerSecond = 2.0f; // Per player
+		std::string saveDirectory = "world"; // Empty runs without persistence
+		std::string columnCachePath = "columns.cache";
+	};
+
+	static bool run(const Settings& settings);
+	static int runFromArguments(int argc, char** argv); // Arguments after --server
+};
@@ -0,0 +1,201 @@
+#include "InputRecording.h"
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+
+static constexpr uint32_t RECORDING_MAGIC = 0x524E4956; // "VINR"
+static constexpr uint32_t RECORDING_VERSION = 1;
+
+struct RecordingHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	int32_t seed;
+	float initialMouseX;
+	float initialMouseY;
+	uint32_t reserved;
+};
+
+InputRecorder::InputRecorder() :
+	file(nullptr), frameCount(0)
+{
+}
+
+InputRecorder::~InputRecorder()
+{
+	close();
+}
+
+bool InputRecorder::open(const std::string& path, int seed, const InputState& initialState)
+{
+	close();
+
+	file = fopen(path.c_str(), "wb");
+	if (!file)
+	{
+		std::cerr << "InputRecorder: Failed to create " << path << "." << std::endl;
+		return false;
+	}
+
+	RecordingHeader header = {};
+	header.magic = RECORDING_MAGIC;
+	header.version = RECORDING_VERSION;
+	header.seed = seed;
+	header.initialMouseX = initialState.mouseX;
+	header.initialMouseY = initialState.mouseY;
+	if (fwrite(&header, sizeof(header), 1, file) != 1)
+	{
+		std::cerr << "InputRecorder: Failed to write " << path << "." << std::endl;
+		close();
+		return false;
+	}
+
+	frameCount = 0;
+	return true;
+}
+
+void InputRecorder::close()
+{
+	if (file)
+	{
+		fclose(file);
+		file = nullptr;
+		std::cout << "InputRecorder: Recorded " << frameCount << " frames." << std::endl;
+	}
+}
+
+// Goes through the stdio buffer, the disk is written every few hundred frames
+void InputRecorder::recordFrame(float deltaTime, const InputState& state)
+{
+	if (!file)
+	{
+		return;
+	}
+
+	InputReplay::Frame frame = { deltaTime, state.keys, state.mouseX, state.mouseY };
+	if (fwrite(&frame, sizeof(frame), 1, file) != 1)
+	{
+		std::cerr << "InputRecorder: Write failed, recording stopped after " << frameCount << " frames." << std::endl;
+		close();
+		return;
+	}
+	frameCount++;
+}
+
+InputReplay::InputReplay() :
+	nextFrameIndex(0), recordedTime(0.0), seed(0)
+{
+}
+
+bool InputReplay::open(const std::string& path)
+{
+	std::ifstream input(path, std::ios::binary);
+	if (!input)
+	{
+		std::cerr << "InputReplay: Failed to open " << path << "." << std::endl;
+		return false;
+	}
+
+	RecordingHeader header;
+	if (!input.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != RECORDING_MAGIC)
+	{
+		std::cerr << "InputReplay: " << path << " isn't an input recording." << std::endl;
+		return false;
+	}
+	if (header.version != RECORDING_VERSION)
+	{
+		std::cerr << "InputReplay: " << path << " has version " << header.version << ", expected " << RECORDING_VERSION << "." << std::endl;
+		return false;
+	}
+
+	// A recording cut off by a crash is replayed up to its last whole frame
+	frames.clear();
+	Frame frame;
+	while (input.read(reinterpret_cast<char*>(&frame), sizeof(frame)))
+	{
+		frames.push_back(frame);
+	}
+
+	seed = header.seed;
+	initialState = InputState();
+	initialState.mouseX = header.initialMouseX;
+	initialState.mouseY = header.initialMouseY;
+	nextFrameIndex = 0;
+	recordedTime = 0.0;
+	frameTimes.reset();
+	worldUpdateTimes.reset();
+
+	double duration = 0.0;
+	for (const Frame& recorded : frames)
+	{
+		duration += recorded.deltaTime;
+	}
+	std::cout << "InputReplay: " << frames.size() << " frames, " << std::fixed << std::setprecision(1) << duration
+		<< " s, seed " << seed << "." << std::endl;
+	return true;
+}
+
+bool InputReplay::nextFrame(float& deltaTime, InputState& state)
+{
+	if (nextFrameIndex >= frames.size())
+	{
+		return false;
+	}
+
+	const Frame& frame = frames[nextFrameIndex++];
+	deltaTime = frame.deltaTime;
+	state.keys = frame.keys;
+	state.mouseX = frame.mouseX;
+	state.mouseY = frame.mouseY;
+	recordedTime += frame.deltaTime;
+	return true;
+}
+
+void InputReplay::recordFrameTime(double seconds)
+{
+	frameTimes.record(static_cast<uint64_t>(seconds * 1e6));
+}
+
+void InputReplay::recordWorldUpdateTime(double seconds)
+{
+	worldUpdateTimes.record(static_cast<uint64_t>(seconds * 1e6));
+}
+
+void InputReplay::printReport(size_t loadedChunks) const
+{
+	std::cout << std::fixed << std::setprecision(2)
+		<< "InputReplay: " << nextFrameIndex << " frames in " << recordedTime << " s recorded time, " << loadedChunks << " chunks loaded\n"
+		<< "  Frame ms: p50 " << frameTimes.getValueAtPercentile(50.0) / 1000.0
+		<< ", p90 " << frameTimes.getValueAtPercentile(90.0) / 1000.0
+		<< ", p99 " << frameTimes.getValueAtPercentile(99.0) / 1000.0
+		<< ", max " << frameTimes.getValueAtPercentile(100.0) / 1000.0 << "\n"
+		<< "  World update ms: p50 " << worldUpdateTimes.getValueAtPercentile(50.0) / 1000.0
+		<< ", p99 " << worldUpdateTimes.getValueAtPercentile(99.0) / 1000.0
+		<< ", max " << worldUpdateTimes.getValueAtPercentile(100.0) / 1000.0 << std::endl;
+}
+
+bool InputReplay::writeReport(const std::string& path, size_t loadedChunks) const
+{
+	std::ofstream output(path);
+	if (!output)
+	{
+		return false;
+	}
+
+	output << std::fixed << std::setprecision(3);
+	output << "{\n  \"benchmark\": \"replay\",\n"
+		<< "  \"frames\": " << nextFrameIndex << ",\n"
+		<< "  \"recordedSeconds\": " << recordedTime << ",\n"
+		<< "  \"worldUpdates\": " << worldUpdateTimes.getTotalCount() << ",\n"
+		<< "  \"chunksLoaded\": " << loadedChunks << ",\n"
+		<< "  \"frameMs\": { \"p50\": " << frameTimes.getValueAtPercentile(50.0) / 1000.0
+		<< ", \"p90\": " << frameTimes.getValueAtPercentile(90.0) / 1000.0
+		<< ", \"p99\": " << frameTimes.getValueAtPercentile(99.0) / 1000.0
+		<< ", \"max\": " << frameTimes.getValueAtPercentile(100.0) / 1000.0 << " },\n"
+		<< "  \"worldUpdateMs\": { \"p50\": " << worldUpdateTimes.getValueAtPercentile(50.0) / 1000.0
+		<< ", \"p99\": " << worldUpdateTimes.getValueAtPercentile(99.0) / 1000.0
+		<< ", \"max\": " << worldUpdateTimes.getValueAtPercentile(100.0) / 1000.0 << " }\n"
+		<< "}\n";
+	return output.good();
+}
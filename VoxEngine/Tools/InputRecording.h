@@ -0,0 +1,79 @@
+#pragma once
+#include "../InputState.h"
+#include "Histogram.h"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstdio>
+
+// Recorded play sessions, for comparing frame and generation timings of real sessions across builds.
+// Every frame is stored with its delta time, so a replay feeds the same time steps to the UpdateTimers and
+// gets the same player and world tick sequence with the same input on each tick.
+// VoxEngine --record <file>, VoxEngine --replay <file> [report.json]
+class InputRecorder
+{
+	FILE* file;
+	uint64_t frameCount;
+public:
+	InputRecorder();
+	~InputRecorder();
+
+	InputRecorder(const InputRecorder&) = delete;
+	InputRecorder& operator=(const InputRecorder&) = delete;
+	InputRecorder(InputRecorder&&) = delete;
+	InputRecorder& operator=(InputRecorder&&) = delete;
+
+	// The initial state holds the mouse position the first frame's delta is measured from
+	bool open(const std::string& path, int seed, const InputState& initialState);
+	void close();
+	bool isOpen() const { return file != nullptr; }
+
+	void recordFrame(float deltaTime, const InputState& state);
+	uint64_t getFrameCount() const { return frameCount; }
+};
+
+class InputReplay
+{
+public:
+	// Written to disk as is
+	struct Frame
+	{
+		float deltaTime;
+		uint32_t keys;
+		float mouseX;
+		float mouseY;
+	};
+	static_assert(sizeof(Frame) == 16, "Recorded frames are stored as 16 bytes");
+private:
+	std::vector<Frame> frames;
+	size_t nextFrameIndex;
+	double recordedTime; // Sum of the delta times handed out so far
+	int seed;
+	InputState initialState;
+
+	// Microseconds
+	LogLinearHistogram frameTimes;
+	LogLinearHistogram worldUpdateTimes;
+public:
+	InputReplay();
+
+	InputReplay(const InputReplay&) = delete;
+	InputReplay& operator=(const InputReplay&) = delete;
+
+	bool open(const std::string& path);
+
+	// False once every recorded frame was replayed
+	bool nextFrame(float& deltaTime, InputState& state);
+
+	int getSeed() const { return seed; }
+	const InputState& getInitialState() const { return initialState; }
+	double getRecordedTime() const { return recordedTime; }
+	size_t getFrameCount() const { return frames.size(); }
+
+	// Timings of the replayed session
+	void recordFrameTime(double seconds);
+	void recordWorldUpdateTime(double seconds);
+	void printReport(size_t loadedChunks) const;
+	bool writeReport(const std::string& path, size_t loadedChunks) const;
+};
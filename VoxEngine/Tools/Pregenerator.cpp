@@ -0,0 +1,120 @@
+#include "Pregenerator.h"
+
+#include "../World.h"
+#include "ThreadPool.h"
+
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+
+// A chunk finishes every stage once the chunks within this distance are loaded
+constexpr int TILE_MARGIN = 2;
+
+bool Pregenerator::run(const Settings& settings)
+{
+	const Int3& minChunk = settings.minChunk;
+	const Int3& maxChunk = settings.maxChunk;
+	if (maxChunk.x < minChunk.x || maxChunk.y < minChunk.y || maxChunk.z < minChunk.z || settings.tileColumns <= 0)
+	{
+		std::cerr << "Pregenerator: Empty area." << std::endl;
+		return false;
+	}
+
+	const int tileColumns = settings.tileColumns;
+	const int tilesX = (maxChunk.x - minChunk.x) / tileColumns + 1;
+	const int tilesZ = (maxChunk.z - minChunk.z) / tileColumns + 1;
+	const size_t totalChunks = static_cast<size_t>(maxChunk.x - minChunk.x + 1) *
+		(maxChunk.y - minChunk.y + 1) * (maxChunk.z - minChunk.z + 1);
+
+	ThreadPool& pool = ParallelUtils::getGlobalThreadPool();
+	World world(pool, settings.seed, false);
+	if (!settings.columnCachePath.empty())
+	{
+		world.getGenerator().openColumnDiskCache(settings.columnCachePath, 1 << 15);
+	}
+
+	// Unedited chunks are stored whole, a delta would generate every chunk a second time on the I/O thread
+	if (!world.openSaveDirectory(settings.saveDirectory, false))
+	{
+		return false;
+	}
+
+	std::cout << "\n=== PREGENERATION, " << totalChunks << " CHUNKS, " << tilesX * tilesZ << " TILES, "
+		<< pool.getThreadCount() << " THREADS ===\n";
+
+	auto start = std::chrono::steady_clock::now();
+	size_t savedChunks = 0;
+	size_t processedChunks = 0;
+	bool complete = true;
+
+	for (int tileZ = 0; tileZ < tilesZ; tileZ++)
+	{
+		for (int i = 0; i < tilesX; i++)
+		{
+			const int tileX = tileZ % 2 == 0 ? i : tilesX - 1 - i;
+			Int3 tileMin(minChunk.x + tileX * tileColumns, minChunk.y, minChunk.z + tileZ * tileColumns);
+			Int3 tileMax(std::min(tileMin.x + tileColumns - 1, maxChunk.x), maxChunk.y, std::min(tileMin.z + tileColumns - 1, maxChunk.z));
+
+			world.loadChunkArea(
+				Int3(tileMin.x - TILE_MARGIN, tileMin.y - TILE_MARGIN, tileMin.z - TILE_MARGIN),
+				Int3(tileMax.x + TILE_MARGIN, tileMax.y + TILE_MARGIN, tileMax.z + TILE_MARGIN));
+			do
+			{
+				world.updateGeneration();
+				std::this_thread::sleep_for(std::chrono::microseconds(200));
+			} while (world.getGenerationTasksInFlight() > 0 || world.getStorageLoadsPending() > 0);
+
+			const size_t tileChunks = static_cast<size_t>(tileMax.x - tileMin.x + 1) *
+				(tileMax.y - tileMin.y + 1) * (tileMax.z - tileMin.z + 1);
+			size_t saved = world.saveChunkArea(tileMin, tileMax);
+			if (saved != tileChunks)
+			{
+				std::cerr << "Pregenerator: Only " << saved << " of " << tileChunks << " chunks in tile " << tileX << ", " << tileZ << " finished." << std::endl;
+				complete = false;
+			}
+			savedChunks += saved;
+			processedChunks += tileChunks;
+
+			double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			double chunksPerSecond = seconds > 0.0 ? processedChunks / seconds : 0.0;
+			double eta = chunksPerSecond > 0.0 ? (totalChunks - processedChunks) / chunksPerSecond : 0.0;
+
+			std::cout << "Tile " << std::setw(5) << tileZ * tilesX + i + 1 << "/" << tilesX * tilesZ << ": "
+				<< std::setw(10) << savedChunks << " chunks, " << std::fixed << std::setprecision(0)
+				<< std::setw(8) << chunksPerSecond << " chunks/s, ETA " << std::setprecision(1) << eta << " s" << std::endl;
+		}
+	}
+
+	// The world writes everything still queued when destroyed
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "Generated " << savedChunks << " chunks in " << std::fixed << std::setprecision(1) << seconds
+		<< " s, writing the rest to " << settings.saveDirectory << "." << std::endl;
+	return complete;
+}
+
+int Pregenerator::runFromArguments(int argc, char** argv)
+{
+	if (argc < 4)
+	{
+		std::cerr << "Usage: VoxEngine --pregenerate minX minZ maxX maxZ [minY maxY] [directory]" << std::endl;
+		return -1;
+	}
+
+	Settings settings;
+	settings.minChunk = Int3(std::atoi(argv[0]), -8, std::atoi(argv[1]));
+	settings.maxChunk = Int3(std::atoi(argv[2]), 8, std::atoi(argv[3]));
+	if (argc >= 6)
+	{
+		settings.minChunk.y = std::atoi(argv[4]);
+		settings.maxChunk.y = std::atoi(argv[5]);
+	}
+	if (argc >= 7)
+	{
+		settings.saveDirectory = argv[6];
+	}
+
+	return run(settings) ? 0 : 1;
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include "Int3.h"
+
+#include <string>
+
+// Generates a box of chunks on every core without a window and writes all of them to a save directory.
+// The box is walked in tiles of whole columns, row by row in alternating direction, so the margin a tile
+// needs around it is mostly still loaded from the previous tile.
+// Runs without a window: VoxEngine --pregenerate minX minZ maxX maxZ [minY maxY] [directory]
+class Pregenerator
+{
+public:
+	struct Settings
+	{
+		Int3 minChunk; // Inclusive, chunk coordinates
+		Int3 maxChunk;
+		int seed = 1337;
+		int tileColumns = 32; // Tile width in chunks
+		std::string saveDirectory = "world";
+		std::string columnCachePath = "columns.cache"; // Empty to skip the column cache
+	};
+
+	static bool run(const Settings& settings);
+	static int runFromArguments(int argc, char** argv); // Arguments after --pregenerate
+};
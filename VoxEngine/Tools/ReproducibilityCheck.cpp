@@ -0,0 +1,90 @@
+#include "ReproducibilityCheck.h"
+
+#include "../World.h"
+#include "ThreadPool.h"
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+// Loaded radius, chunks closer than 3 to the border finish every stage
+constexpr int REGION_RADIUS = 6;
+
+static uint64_t mixHash(uint64_t value)
+{
+	value ^= value >> 33;
+	value *= 0xFF51AFD7ED558CCDull;
+	value ^= value >> 33;
+	value *= 0xC4CEB9FE1A85EC53ull;
+	value ^= value >> 33;
+	return value;
+}
+
+ReproducibilityCheck::RegionHash ReproducibilityCheck::generateRegion(int seed, size_t threadCount, int radius)
+{
+	RegionHash result;
+	ThreadPool pool(threadCount);
+	World world(pool, seed, false);
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	world.loadChunksAroundPlayer(Int3(0, 0, 0), radius);
+	do
+	{
+		world.updateGeneration();
+		std::this_thread::sleep_for(std::chrono::microseconds(200));
+	} while (world.getGenerationTasksInFlight() > 0);
+
+	auto end = std::chrono::high_resolution_clock::now();
+	result.seconds = std::chrono::duration<double>(end - start).count();
+
+	// Sum of per chunk hashes, so the chunk map's iteration order doesn't matter
+	world.forEachChunk([&result](const Chunk& chunk)
+		{
+			if (chunk.getState() != Chunk::State::NeedsMesh)
+			{
+				return;
+			}
+
+			Int3 pos = chunk.getPosition();
+			uint64_t positionHash = mixHash((static_cast<uint64_t>(static_cast<uint32_t>(pos.x)) << 42) ^
+				(static_cast<uint64_t>(static_cast<uint32_t>(pos.y)) << 21) ^ static_cast<uint32_t>(pos.z));
+			result.hash += mixHash(chunk.hashContents() ^ positionHash);
+			result.chunkCount++;
+		});
+
+	return result;
+}
+
+bool ReproducibilityCheck::run(int seed)
+{
+	std::cout << "\n=== GENERATION REPRODUCIBILITY, SEED " << seed << " ===\n";
+
+	size_t hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+	std::vector<size_t> threadCounts = { 1, 4, hardwareThreads };
+
+	bool identical = true;
+	RegionHash reference;
+	for (size_t i = 0; i < threadCounts.size(); i++)
+	{
+		RegionHash region = generateRegion(seed, threadCounts[i], REGION_RADIUS);
+
+		std::cout << std::left << std::setw(4) << threadCounts[i] << " threads: "
+			<< std::hex << std::setw(18) << region.hash << std::dec
+			<< region.chunkCount << " chunks in " << std::fixed << std::setprecision(3) << region.seconds << " s" << std::endl;
+
+		if (i == 0)
+		{
+			reference = region;
+		}
+		else if (region.hash != reference.hash || region.chunkCount != reference.chunkCount)
+		{
+			identical = false;
+		}
+	}
+
+	std::cout << (identical ? "Identical across thread counts." : "MISMATCH between thread counts!") << std::endl;
+	return identical;
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+// Generates the same region with 1, 4 and all hardware threads and compares content hashes.
+// Runs without a window: VoxEngine --reproducibility [seed]
+class ReproducibilityCheck
+{
+public:
+	struct RegionHash
+	{
+		uint64_t hash = 0;      // Order independent combination of chunk hashes
+		size_t chunkCount = 0;  // Chunks that finished every generation stage
+		double seconds = 0.0;
+	};
+
+	static RegionHash generateRegion(int seed, size_t threadCount, int radius);
+
+	// Returns false if any thread count produced different chunks
+	static bool run(int seed);
+};
@@ -106,6 +106,23 @@ void WindowManager::getMousePos(float& xpos, float& ypos) const
 	ypos = static_cast<float>(ypos_);
 }
 
+InputState WindowManager::getInputState() const
+{
+	static constexpr int KEY_BINDINGS[static_cast<int>(InputKey::Count)] =
+	{
+		GLFW_KEY_W, GLFW_KEY_S, GLFW_KEY_A, GLFW_KEY_D, GLFW_KEY_SPACE, GLFW_KEY_LEFT_CONTROL, GLFW_KEY_LEFT_SHIFT,
+		GLFW_KEY_P, GLFW_KEY_O, GLFW_KEY_F5, GLFW_KEY_F9
+	};
+
+	InputState state;
+	for (int i = 0; i < static_cast<int>(InputKey::Count); i++)
+	{
+		state.setKeyPressed(static_cast<InputKey>(i), isKeyPressed(KEY_BINDINGS[i]));
+	}
+	getMousePos(state.mouseX, state.mouseY);
+	return state;
+}
+
 void WindowManager::framebufferSizeCallback(GLFWwindow* window, int width, int height)
 {
     glViewport(0, 0, width, height);
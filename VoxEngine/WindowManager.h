@@ -1,6 +1,7 @@
 #pragma once
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
+#include "InputState.h"
 #include <string>
 
 // Struct to hold window initialization parameters
@@ -38,6 +39,7 @@ public:
     //
 	bool isKeyPressed(int key) const;
 	void getMousePos(float& xpos, float& ypos) const;
+	InputState getInputState() const; // Key bindings live here
 
     // Static forwarding callbacks
 	static void framebufferSizeCallback(GLFWwindow* window, int width, int height);
@@ -2,64 +2,298 @@
 
 #include "Profiler.h"
 #include "ThreadPool.h"
+#include "TerrainGenerator.h"
+#include "ChunkRegion.h"
+#include "ColumnDiskCache.h"
+#include "Graphics/Shader.h"
 
 #include <iostream>
+#include <algorithm>
 
-World::World()
+World::World(ThreadPool& threadPool, int seed, bool meshing) :
+	generator(seed), threadPool(threadPool), meshing(meshing)
 {
 }
 
 World::~World()
 {
+	// Stage tasks reference this world and its chunks
+	waitForGenerationTasks();
+
+	for (const Int3& pos : snapshotChunks)
+	{
+		captureSnapshotChunk(chunks[pos].get());
+	}
+	snapshotChunks.clear();
+	updateSnapshot();
+
+	saveModifiedChunks();
+	chunkStore.close();
+
+	// Everything is written, only replayed edits of chunks that weren't loaded are still needed
+	if (editJournal.isOpen())
+	{
+		uint64_t file = editJournal.rotate();
+		for (const auto& pair : journalReplayEdits)
+		{
+			for (const EditJournal::Entry& entry : pair.second)
+			{
+				editJournal.append(entry);
+			}
+		}
+		editJournal.discardBefore(file);
+		editJournal.close();
+	}
+}
+
+bool World::openSaveDirectory(const std::string& directory, bool deltaSaves)
+{
+	if (!chunkStore.open(directory, &generator, deltaSaves))
+	{
+		return false;
+	}
+
+	std::vector<EditJournal::Entry> entries;
+	if (editJournal.open(directory, entries))
+	{
+		for (const EditJournal::Entry& entry : entries)
+		{
+			journalReplayEdits[Int3(entry.chunkX, entry.chunkY, entry.chunkZ)].push_back(entry);
+		}
+	}
+	lastJournalCheckpoint = std::chrono::steady_clock::now();
+
+	for (const auto& pair : chunks)
+	{
+		if (pair.second->getGenerationStage() == static_cast<int>(GenerationStage::Count) && !applyReplayedEdits(pair.second.get()))
+		{
+			journalReplayBlocked.push_back(pair.first);
+		}
+	}
+	return true;
+}
+
+void World::saveModifiedChunks()
+{
+	PROFILE_SCOPE("Save modified chunks");
+
+	for (const auto& pair : chunks)
+	{
+		if (pair.second->isUnsaved())
+		{
+			saveChunk(pair.second.get());
+		}
+	}
+}
+
+size_t World::saveChunkArea(const Int3& minChunk, const Int3& maxChunk)
+{
+	if (!chunkStore.isOpen())
+	{
+		return 0;
+	}
+
+	size_t count = 0;
+	for (int chunkX = minChunk.x; chunkX <= maxChunk.x; chunkX++)
+	{
+		for (int chunkZ = minChunk.z; chunkZ <= maxChunk.z; chunkZ++)
+		{
+			for (int chunkY = minChunk.y; chunkY <= maxChunk.y; chunkY++)
+			{
+				auto it = chunks.find(Int3(chunkX, chunkY, chunkZ));
+				if (it != chunks.end() && it->second->getGenerationStage() == static_cast<int>(GenerationStage::Count))
+				{
+					saveChunk(it->second.get());
+					count++;
+				}
+			}
+		}
+	}
+	return count;
+}
+
+bool World::beginSnapshot(const std::string& directory)
+{
+	if (snapshotCapturing || !chunkStore.beginSnapshot(directory))
+	{
+		return false;
+	}
+
+	for (const auto& pair : chunks)
+	{
+		if (pair.second->isUnsaved())
+		{
+			snapshotChunks.insert(pair.first);
+		}
+	}
+	snapshotCapturing = true;
+	return true;
+}
+
+void World::captureSnapshotChunk(Chunk* chunk)
+{
+	if (snapshotChunks.erase(chunk->getPosition()))
+	{
+		chunkStore.addSnapshotChunk(chunk->getPosition(), chunk->isUniform(), chunk->getUniformBlock(), chunk->getBlockData());
+	}
+}
+
+void World::updateSnapshot()
+{
+	if (!snapshotCapturing)
+	{
+		return;
+	}
+
+	PROFILE_SCOPE("Capture snapshot chunks");
+
+	// Generation never changes blocks of edited chunks, they can be copied while locked
+	size_t count = 0;
+	for (auto it = snapshotChunks.begin(); it != snapshotChunks.end() && count < SNAPSHOT_CHUNKS_PER_UPDATE; count++)
+	{
+		Chunk* chunk = chunks[*it].get();
+		it = snapshotChunks.erase(it);
+		chunkStore.addSnapshotChunk(chunk->getPosition(), chunk->isUniform(), chunk->getUniformBlock(), chunk->getBlockData());
+	}
+
+	if (snapshotChunks.empty())
+	{
+		chunkStore.endSnapshotCapture();
+		snapshotCapturing = false;
+	}
+}
+
+void World::saveChunk(Chunk* chunk)
+{
+	if (!chunkStore.isOpen())
+	{
+		return;
+	}
+
+	// Copied here, encoded and written on the I/O thread
+	chunkStore.requestSave(chunk->getPosition(), chunk->isUniform(), chunk->getUniformBlock(), chunk->getBlockData());
+	chunk->markSaved();
 }
 
 void World::loadChunksAroundPlayer(const Int3& chunkLoaderPos, int renderDistance)
 {
-	if (!firstLoad && lastChunkLoaderPos == chunkLoaderPos)
+	loadChunksAroundPlayers({ chunkLoaderPos }, renderDistance);
+}
+
+void World::loadChunksAroundPlayers(const std::vector<Int3>& chunkLoaderPositions, int renderDistance)
+{
+	std::vector<ChunkArea> areas;
+	areas.reserve(chunkLoaderPositions.size());
+	for (const Int3& pos : chunkLoaderPositions)
+	{
+		areas.push_back({
+			Int3(pos.x - renderDistance, pos.y - renderDistance, pos.z - renderDistance),
+			Int3(pos.x + renderDistance, pos.y + renderDistance, pos.z + renderDistance) });
+	}
+	loadChunkAreas(areas);
+}
+
+void World::loadChunkArea(const Int3& minChunk, const Int3& maxChunk)
+{
+	loadChunkAreas({ { minChunk, maxChunk } });
+}
+
+void World::loadChunkAreas(const std::vector<ChunkArea>& areas)
+{
+	if (!firstLoad && !unloadDeferred && lastLoadAreas == areas)
     {
         return;
     }
 	firstLoad = false;
-	lastChunkLoaderPos = chunkLoaderPos;
+	lastLoadAreas = areas;
+
+	auto outside = [&areas](const Int3& pos, int border)
+		{
+			for (const ChunkArea& area : areas)
+			{
+				if (pos.x >= area.minChunk.x - border && pos.x <= area.maxChunk.x + border &&
+					pos.y >= area.minChunk.y - border && pos.y <= area.maxChunk.y + border &&
+					pos.z >= area.minChunk.z - border && pos.z <= area.maxChunk.z + border)
+				{
+					return false;
+				}
+			}
+			return true;
+		};
 
 	// Unload chunks that are out of range
 	{
 		PROFILE_SCOPE("Unload chunks");
 
+		unloadDeferred = false;
+
 		std::vector<Int3> chunksToUnload;
 		for (const auto& pair : chunks)
 		{
 			const Int3& pos = pair.first;
-			if (std::abs(pos.x - chunkLoaderPos.x) > renderDistance ||
-				std::abs(pos.y - chunkLoaderPos.y) > renderDistance ||
-				std::abs(pos.z - chunkLoaderPos.z) > renderDistance)
+			if (outside(pos, 0))
 			{
+				// Stage tasks may still be using it, retry next time
+				if (pair.second->isGenerationLocked())
+				{
+					unloadDeferred = true;
+					continue;
+				}
 				chunksToUnload.push_back(pos);
 			}
 		}
 		for (const Int3& pos : chunksToUnload)
 		{
 			auto it = chunks.find(pos);
+			Chunk* chunk = it->second.get();
+
+			captureSnapshotChunk(chunk);
+			if (chunk->isUnsaved())
+			{
+				saveChunk(chunk);
+			}
+			storageLoads.erase(pos);
+			storedChunkData.erase(chunk);
+
+			generationChunkContainer.erase(chunk);
+			{
+				std::lock_guard<std::mutex> lock(meshBuildMutex);
+				meshBuildChunkContainer.erase(chunk);
+			}
+
 			chunkPool.release(std::move(it->second));
 			chunks.erase(it);
 		}
+
+		// Writes further than one chunk outside the range came from unloaded chunks, which send them again once reloaded
+		for (auto it = pendingBlockWrites.begin(); it != pendingBlockWrites.end();)
+		{
+			if (outside(it->first, 1))
+			{
+				pendingBlockWriteCount -= it->second.size();
+				it = pendingBlockWrites.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
 	}
 
-	// Load chunks in a cubic area around the chunkLoaderPos
-	// TODO: Make area spherical
+	// Column by column, so a column's chunks are generated together and share its column data
 	{
 		PROFILE_SCOPE("Load chunks");
 
-		for (int x = -renderDistance; x <= renderDistance; x++)
+		for (const ChunkArea& area : areas)
 		{
-			int chunkX = chunkLoaderPos.x + x;
-			for (int y = -renderDistance; y <= renderDistance; y++)
+			for (int chunkX = area.minChunk.x; chunkX <= area.maxChunk.x; chunkX++)
 			{
-				int chunkY = chunkLoaderPos.y + y;
-				for (int z = -renderDistance; z <= renderDistance; z++)
+				for (int chunkZ = area.minChunk.z; chunkZ <= area.maxChunk.z; chunkZ++)
 				{
-					int chunkZ = chunkLoaderPos.z + z;
-					loadChunk(chunkX, chunkY, chunkZ);
+					for (int chunkY = area.minChunk.y; chunkY <= area.maxChunk.y; chunkY++)
+					{
+						loadChunk(chunkX, chunkY, chunkZ);
+					}
 				}
 			}
 		}
@@ -68,15 +302,51 @@ void World::loadChunksAroundPlayer(const Int3& chunkLoaderPos, int renderDistanc
 
 void World::update()
 {
-	if (!blocksBuildChunkContainer.empty())
-	{
-		startBuildingChunkBlocks();
-	}
+	updateGeneration();
 
 	if (!meshBuildChunkContainer.empty())
 	{
 		buildChunkMeshes();
 	}
+
+	recordProfilerCounters();
+}
+
+void World::updateGeneration()
+{
+	collectGenerationResults();
+	collectStorageLoads();
+	updateSnapshot();
+	updateJournal();
+
+	if (!deferredBlockEdits.empty())
+	{
+		std::vector<BlockEdit> edits;
+		edits.swap(deferredBlockEdits);
+		size_t droppedEdits = 0;
+		for (const BlockEdit& edit : edits)
+		{
+			droppedEdits += applyBlockEdit(edit) ? 0 : 1;
+		}
+		if (droppedEdits > 0)
+		{
+			std::cerr << "World: " << droppedEdits << " deferred block edits dropped, their chunks were unloaded." << std::endl;
+		}
+	}
+
+	if (generationDirty)
+	{
+		scheduleGenerationStages();
+	}
+}
+
+void World::waitForGenerationTasks()
+{
+	while (generationTasksInFlight > 0)
+	{
+		std::this_thread::yield();
+		collectGenerationResults();
+	}
 }
 
 void World::render(const Shader& faceShader) const
@@ -218,62 +488,437 @@ void World::loadChunk(int chunkX, int chunkY, int chunkZ)
 	chunk->init(chunkX, chunkY, chunkZ, neighbors);
 	Chunk* chunkPtr = chunk.get();
 
-	// Add to blocks build queue
+	chunks[chunk->getPosition()] = std::move(chunk);
+
+	// Saved chunks are looked up first, generation starts once the store answered
+	if (chunkStore.isOpen())
 	{
-		std::lock_guard<std::mutex> lock(blocksBuildMutex);
-		blocksBuildChunkContainer.insert(chunkPtr);
+		storageLoads[chunkPtr->getPosition()] = chunkPtr;
+		chunkStore.requestLoad(chunkPtr->getPosition());
+		return;
 	}
+	startGeneration(chunkPtr);
+}
 
-	chunks[chunk->getPosition()] = std::move(chunk);
+void World::startGeneration(Chunk* chunk)
+{
+	generationChunkContainer.insert(chunk);
+	generationDirty = true;
 }
 
-void World::startBuildingChunkBlocks()
+void World::collectStorageLoads()
 {
-	// Maybe add PROFILE_SCOPE inside Chunk::buildBlocks. Make Profiler thread safe.
-	PROFILE_SCOPE("Start building chunk blocks");
+	if (storageLoads.empty())
+	{
+		return;
+	}
 
-	// Collect chunks that need block building
-	std::vector<Chunk*> chunksToProcess;
+	std::vector<ChunkStore::LoadResult> results;
+	chunkStore.collectLoadResults(results);
+	for (ChunkStore::LoadResult& result : results)
 	{
-		std::lock_guard<std::mutex> lock(blocksBuildMutex);
-		if (blocksBuildChunkContainer.empty())
+		// Chunk was unloaded while the request was in flight
+		auto it = storageLoads.find(result.position);
+		if (it == storageLoads.end())
 		{
-			return;
+			continue;
 		}
 
-		chunksToProcess.reserve(blocksBuildChunkContainer.size());
-		for (Chunk* chunk : blocksBuildChunkContainer)
+		Chunk* chunk = it->second;
+		storageLoads.erase(it);
+		if (result.found)
 		{
-			chunk->setState(Chunk::State::BuildingBlocks);
-			chunksToProcess.push_back(chunk);
+			storedChunkData[chunk] = std::move(result.data);
 		}
-		blocksBuildChunkContainer.clear();
+		startGeneration(chunk);
 	}
+}
 
-	// Submit work to thread pool
-	// TODO: Maybe batch for less mutex locking
-	ThreadPool& pool = ParallelUtils::getGlobalThreadPool();
-	for (Chunk* chunk : chunksToProcess)
+Block World::getBlock(const Int3& position) const
+{
+	Int3 chunkPos(
+		(position.x & CHUNK_UPPER_BITS_MASK) / CHUNK_SIZE,
+		(position.y & CHUNK_UPPER_BITS_MASK) / CHUNK_SIZE,
+		(position.z & CHUNK_UPPER_BITS_MASK) / CHUNK_SIZE);
+
+	auto it = chunks.find(chunkPos);
+	if (it == chunks.end() || it->second->getGenerationStage() < static_cast<int>(GenerationStage::Count))
+	{
+		return Block::Air;
+	}
+	return it->second->getBlock_inBoundaries(
+		position.x & CHUNK_LOWER_BITS_MASK, position.y & CHUNK_LOWER_BITS_MASK, position.z & CHUNK_LOWER_BITS_MASK);
+}
+
+bool World::setBlock(const Int3& position, Block block)
+{
+	return applyBlockEdit({ position, block });
+}
+
+bool World::applyBlockEdit(const BlockEdit& edit)
+{
+	const Int3& position = edit.position;
+	Int3 chunkPos(
+		(position.x & CHUNK_UPPER_BITS_MASK) / CHUNK_SIZE,
+		(position.y & CHUNK_UPPER_BITS_MASK) / CHUNK_SIZE,
+		(position.z & CHUNK_UPPER_BITS_MASK) / CHUNK_SIZE);
+
+	auto it = chunks.find(chunkPos);
+	if (it == chunks.end())
+	{
+		return false;
+	}
+
+	// Edits only go into finished chunks. A running Light task reads the blocks, so those edits wait for it.
+	Chunk* chunk = it->second.get();
+	if (chunk->getGenerationStage() < static_cast<int>(GenerationStage::Count))
 	{
-		pool.enqueue([this, chunk]()
+		return false;
+	}
+	if (chunk->isGenerationLocked())
+	{
+		deferredBlockEdits.push_back(edit);
+		return true;
+	}
+
+	int x = position.x & CHUNK_LOWER_BITS_MASK;
+	int y = position.y & CHUNK_LOWER_BITS_MASK;
+	int z = position.z & CHUNK_LOWER_BITS_MASK;
+	Block oldBlock = chunk->getBlock_inBoundaries(x, y, z);
+	if (oldBlock == edit.block)
+	{
+		return true;
+	}
+	captureSnapshotChunk(chunk);
+	chunk->setBlock_inBoundaries(x, y, z, edit.block);
+	chunk->markEdited();
+	if (editJournal.isOpen())
+	{
+		editJournal.append({ chunkPos.x, chunkPos.y, chunkPos.z, static_cast<uint16_t>(getChunkBlockIndex(x, y, z)), oldBlock, edit.block });
+	}
+
+	std::vector<Chunk*> relightChunks;
+	collectRelightChunks(chunkPos, x, y, z, relightChunks);
+	for (Chunk* relightChunk : relightChunks)
+	{
+		requestRelight(relightChunk);
+	}
+	return true;
+}
+
+// Every chunk whose Light region covers the block, border blocks are part of the neighbours' regions
+void World::collectRelightChunks(const Int3& chunkPos, int x, int y, int z, std::vector<Chunk*>& relightChunks) const
+{
+	const int local[3] = { x, y, z };
+	for (int dx = -1; dx <= 1; dx++)
+	{
+		for (int dy = -1; dy <= 1; dy++)
+		{
+			for (int dz = -1; dz <= 1; dz++)
 			{
-				// Build blocks in background thread
-				chunk->buildBlocks();
+				const int offset[3] = { dx, dy, dz };
+				bool touches = true;
+				for (int axis = 0; axis < 3; axis++)
+				{
+					touches = touches && (offset[axis] == 0 ||
+						(offset[axis] < 0 && local[axis] == 0) ||
+						(offset[axis] > 0 && local[axis] == CHUNK_SIZE - 1));
+				}
+				if (!touches)
+				{
+					continue;
+				}
 
-				// Mark as needing mesh
-				chunk->setState(Chunk::State::NeedsMesh);
+				auto neighbor = chunks.find(Int3(chunkPos.x + dx, chunkPos.y + dy, chunkPos.z + dz));
+				if (neighbor != chunks.end() &&
+					std::find(relightChunks.begin(), relightChunks.end(), neighbor->second.get()) == relightChunks.end())
+				{
+					relightChunks.push_back(neighbor->second.get());
+				}
+			}
+		}
+	}
+}
 
-				std::lock_guard<std::mutex> lock(meshBuildMutex);
-				meshBuildChunkContainer.insert(chunk);
+// Runs the Light stage again. The chunk stays finished, so it keeps taking edits and rendering its old mesh
+// until the new one is built.
+void World::requestRelight(Chunk* chunk)
+{
+	if (chunk->getGenerationStage() < static_cast<int>(GenerationStage::Count))
+	{
+		return; // Its Light stage hasn't run yet
+	}
+
+	chunk->setRelightPending(true);
+	generationChunkContainer.insert(chunk);
+	generationDirty = true;
+}
+
+void World::updateJournal()
+{
+	if (!editJournal.isOpen())
+	{
+		return;
+	}
+
+	editJournal.update();
+
+	if (!journalReplayBlocked.empty())
+	{
+		std::vector<Int3> positions;
+		positions.swap(journalReplayBlocked);
+		for (const Int3& position : positions)
+		{
+			// Unloaded chunks keep their edits in journalReplayEdits until they are generated again
+			auto it = chunks.find(position);
+			if (it != chunks.end() && !applyReplayedEdits(it->second.get()))
+			{
+				journalReplayBlocked.push_back(position);
+			}
+		}
+	}
+
+	if (journalCheckpointFlush != 0 && chunkStore.isFlushComplete(journalCheckpointFlush))
+	{
+		editJournal.discardBefore(journalCheckpointFile);
+		journalCheckpointFlush = 0;
+	}
+
+	if (journalCheckpointFlush == 0 && std::chrono::steady_clock::now() - lastJournalCheckpoint >= JOURNAL_CHECKPOINT_INTERVAL)
+	{
+		checkpointJournal();
+	}
+}
+
+// Saves every edited chunk, the journal files written so far are only needed until those saves are on disk
+void World::checkpointJournal()
+{
+	PROFILE_SCOPE("Journal checkpoint");
+
+	lastJournalCheckpoint = std::chrono::steady_clock::now();
+	saveModifiedChunks();
+	journalCheckpointFile = editJournal.rotate();
+
+	// Replayed edits of chunks that weren't loaded since only exist in the older files
+	for (const auto& pair : journalReplayEdits)
+	{
+		for (const EditJournal::Entry& entry : pair.second)
+		{
+			editJournal.append(entry);
+		}
+	}
+	journalCheckpointFlush = chunkStore.requestFlush();
+}
+
+// Edits journaled before a crash, written in their original order and journaled again. The chunks around them
+// are relit once afterwards. False if the chunk is part of a running task's region, its edits stay queued.
+bool World::applyReplayedEdits(Chunk* chunk)
+{
+	auto it = journalReplayEdits.find(chunk->getPosition());
+	if (it == journalReplayEdits.end())
+	{
+		return true;
+	}
+	if (chunk->isGenerationLocked())
+	{
+		return false;
+	}
+
+	captureSnapshotChunk(chunk);
+	const Int3& chunkPos = chunk->getPosition();
+	std::vector<Chunk*> relightChunks;
+	for (const EditJournal::Entry& entry : it->second)
+	{
+		int x = (entry.index >> 8) & CHUNK_LOWER_BITS_MASK;
+		int y = (entry.index >> 4) & CHUNK_LOWER_BITS_MASK;
+		int z = entry.index & CHUNK_LOWER_BITS_MASK;
+		chunk->setBlock_inBoundaries(x, y, z, entry.newBlock);
+		if (editJournal.isOpen())
+		{
+			editJournal.append(entry);
+		}
+		collectRelightChunks(chunkPos, x, y, z, relightChunks);
+	}
+	chunk->markEdited();
+	journalReplayEdits.erase(it);
+
+	for (Chunk* relightChunk : relightChunks)
+	{
+		requestRelight(relightChunk);
+	}
+	return true;
+}
+
+// Advances chunks whose stage task finished and frees their regions
+void World::collectGenerationResults()
+{
+	std::vector<GenerationResult> finishedTasks;
+	{
+		std::lock_guard<std::mutex> lock(generationResultsMutex);
+		finishedTasks.swap(generationResults);
+	}
+
+	for (GenerationResult& result : finishedTasks)
+	{
+		Chunk* chunk = result.chunk;
+		generationTasksInFlight--;
+		generationDirty = true;
+
+		// Merged before the stage advances, so every write into a chunk is stored before its Light stage can start
+		for (const PendingBlockWrite& write : result.pendingWrites)
+		{
+			pendingBlockWrites[write.chunk].push_back(write);
+		}
+		pendingBlockWriteCount += result.pendingWrites.size();
+
+		int stage = result.relight ? static_cast<int>(GenerationStage::Light) : chunk->getGenerationStage();
+		ChunkRegion region;
+		region.gather(chunk, TerrainGenerator::getStageRadius(static_cast<GenerationStage>(stage)));
+		region.forEachChunk([](Chunk* regionChunk) { regionChunk->setGenerationLocked(false); });
 
-				for (int i = 0; i < 6; i++)
+		if (!result.relight)
+		{
+			chunk->setGenerationStage(stage + 1);
+			if (stage + 1 < static_cast<int>(GenerationStage::Count))
+			{
+				continue;
+			}
+		}
+
+		// All stages done, mesh it and remesh neighbours that can now see its blocks and light.
+		// Relit chunks keep their Ready state and old mesh until the new one is built.
+		// Edits during the relight requested another one.
+		if (!chunk->isRelightPending())
+		{
+			generationChunkContainer.erase(chunk);
+		}
+		if (chunk->getState() != Chunk::State::Ready)
+		{
+			chunk->setState(Chunk::State::NeedsMesh);
+		}
+		if (!journalReplayEdits.empty() && !applyReplayedEdits(chunk))
+		{
+			journalReplayBlocked.push_back(chunk->getPosition());
+		}
+		if (!meshing)
+		{
+			continue;
+		}
+
+		std::lock_guard<std::mutex> lock(meshBuildMutex);
+		meshBuildChunkContainer.insert(chunk);
+		for (int i = 0; i < 6; i++)
+		{
+			Chunk* neighbor = chunk->neighbors[i];
+			if (neighbor && neighbor->getState() == Chunk::State::Ready)
+			{
+				meshBuildChunkContainer.insert(neighbor);
+			}
+		}
+	}
+}
+
+// Starts every stage whose region is loaded, unlocked and done with the previous stage
+void World::scheduleGenerationStages()
+{
+	PROFILE_SCOPE("Schedule generation stages");
+
+	generationDirty = false;
+
+	for (Chunk* chunk : generationChunkContainer)
+	{
+		if (chunk->isGenerationLocked())
+		{
+			continue;
+		}
+
+		// A finished chunk only runs Light again
+		const bool relight = chunk->isRelightPending();
+		const int stage = relight ? static_cast<int>(GenerationStage::Light) : chunk->getGenerationStage();
+		if (stage >= static_cast<int>(GenerationStage::Count))
+		{
+			continue;
+		}
+		const GenerationStage generationStage = static_cast<GenerationStage>(stage);
+
+		ChunkRegion region;
+		if (!region.gather(chunk, TerrainGenerator::getStageRadius(generationStage)))
+		{
+			continue;
+		}
+
+		bool ready = true;
+		region.forEachChunk([&ready, stage](Chunk* regionChunk)
+			{
+				ready = ready && !regionChunk->isGenerationLocked() && regionChunk->getGenerationStage() >= stage;
+			});
+		if (!ready)
+		{
+			continue;
+		}
+
+		region.forEachChunk([](Chunk* regionChunk) { regionChunk->setGenerationLocked(true); });
+		chunk->setRelightPending(false);
+		if (chunk->getState() == Chunk::State::NeedsBlocks)
+		{
+			chunk->setState(Chunk::State::BuildingBlocks);
+		}
+		generationTasksInFlight++;
+
+		// Light reads the whole region, so writes into any of its chunks are applied first.
+		// Saved and edited chunks already contain their features, writes into them are dropped.
+		std::vector<PendingBlockWrite> writesToApply;
+		if (generationStage == GenerationStage::Light)
+		{
+			region.forEachChunk([this, &writesToApply](Chunk* regionChunk)
 				{
-					Chunk* neighbor = chunk->neighbors[i];
-					if (neighbor && neighbor->getState() == Chunk::State::Ready)
+					auto it = pendingBlockWrites.find(regionChunk->getPosition());
+					if (it != pendingBlockWrites.end())
 					{
-						meshBuildChunkContainer.insert(neighbor);
+						if (!regionChunk->isModified())
+						{
+							writesToApply.insert(writesToApply.end(), it->second.begin(), it->second.end());
+						}
+						pendingBlockWriteCount -= it->second.size();
+						pendingBlockWrites.erase(it);
 					}
+				});
+		}
+
+		// Saved blocks replace the generated ones once the chunk has sent its features to the neighbours
+		bool hasStoredData = false;
+		ChunkStore::ChunkData storedData;
+		if (generationStage == GenerationStage::Features)
+		{
+			auto it = storedChunkData.find(chunk);
+			if (it != storedChunkData.end())
+			{
+				hasStoredData = true;
+				storedData = std::move(it->second);
+				storedChunkData.erase(it);
+			}
+		}
+
+		threadPool.enqueue([this, region, generationStage, relight, writesToApply = std::move(writesToApply),
+			hasStoredData, storedData = std::move(storedData)]() mutable
+			{
+				GenerationResult result;
+				result.chunk = region.getCenter();
+				result.relight = relight;
+
+				if (!writesToApply.empty())
+				{
+					generator.applyPendingWrites(region, writesToApply);
+				}
+				generator.runStage(generationStage, region, result.pendingWrites);
+
+				if (hasStoredData)
+				{
+					region.getCenter()->setStoredBlocks(storedData.uniform, storedData.uniformBlock, storedData.blocks.data());
 				}
+
+				std::lock_guard<std::mutex> lock(generationResultsMutex);
+				generationResults.push_back(std::move(result));
 			});
 	}
 }
@@ -297,8 +942,15 @@ void World::buildChunkMeshes()
 		chunksToProcess.reserve(meshBuildChunkContainer.size());
 		for (Chunk* chunk : meshBuildChunkContainer)
 		{
+			// Neighbours inside a running stage task's region may be written to
+			bool neighborLocked = chunk->isGenerationLocked();
+			for (int i = 0; i < 6; i++)
+			{
+				neighborLocked = neighborLocked || (chunk->neighbors[i] && chunk->neighbors[i]->isGenerationLocked());
+			}
+
 			Chunk::State state = chunk->getState();
-			if (state == Chunk::State::NeedsMesh || state == Chunk::State::Ready)
+			if (!neighborLocked && (state == Chunk::State::NeedsMesh || state == Chunk::State::Ready))
 			{
 				chunksToProcess.push_back(chunk);
 			}
@@ -318,6 +970,50 @@ void World::buildChunkMeshes()
 	}
 }
 
+// Queue depths and chunk states for hitch captures
+void World::recordProfilerCounters()
+{
+	size_t stateCounts[4] = { 0, 0, 0, 0 };
+	size_t uniformChunks = 0;
+	for (const auto& pair : chunks)
+	{
+		Chunk::State state = pair.second->getState();
+		stateCounts[(size_t)state]++;
+
+		if (state != Chunk::State::NeedsBlocks && state != Chunk::State::BuildingBlocks && pair.second->isUniform())
+		{
+			uniformChunks++;
+		}
+	}
+
+	PROFILE_COUNTER("Chunks NeedsBlocks", stateCounts[(size_t)Chunk::State::NeedsBlocks]);
+	PROFILE_COUNTER("Chunks BuildingBlocks", stateCounts[(size_t)Chunk::State::BuildingBlocks]);
+	PROFILE_COUNTER("Chunks NeedsMesh", stateCounts[(size_t)Chunk::State::NeedsMesh]);
+	PROFILE_COUNTER("Chunks Ready", stateCounts[(size_t)Chunk::State::Ready]);
+	PROFILE_COUNTER("Uniform chunks", uniformChunks);
+
+	size_t meshQueue;
+	{
+		std::lock_guard<std::mutex> lock(meshBuildMutex);
+		meshQueue = meshBuildChunkContainer.size();
+	}
+	PROFILE_COUNTER("Generation queue", generationChunkContainer.size());
+	PROFILE_COUNTER("Generation tasks", generationTasksInFlight);
+	PROFILE_COUNTER("Pending block writes", pendingBlockWriteCount);
+	PROFILE_COUNTER("Mesh build queue", meshQueue);
+	PROFILE_COUNTER("Storage loads in flight", chunkStore.getLoadsInFlight());
+	PROFILE_COUNTER("Storage dirty chunks", chunkStore.getDirtyChunkCount());
+	PROFILE_COUNTER("Journal uncommitted edits", editJournal.getUncommittedEntryCount());
+	PROFILE_COUNTER("Snapshot chunks to capture", snapshotChunks.size());
+	PROFILE_COUNTER("Thread pool tasks", threadPool.getPendingTaskCount());
+	PROFILE_COUNTER("Chunk column data", generator.getChunkColumnDataCount());
+	if (const ColumnDiskCache* columnDiskCache = generator.getColumnDiskCache())
+	{
+		PROFILE_COUNTER("Column disk cache hits", columnDiskCache->getHitCount());
+		PROFILE_COUNTER("Column disk cache misses", columnDiskCache->getMissCount());
+	}
+}
+
 std::unique_ptr<Chunk> World::ChunkPool::acquire()
 {
 	if (!pool.empty())
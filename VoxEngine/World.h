@@ -1,7 +1,10 @@
 #pragma once
 #include "Chunk.h"
+#include "TerrainGenerator.h"
 
-#include "Graphics/Shader.h"
+#include "ThreadPool.h"
+#include "Storage/ChunkStore.h"
+#include "Storage/EditJournal.h"
 
 #include <unordered_map>
 #include <unordered_set>
@@ -9,9 +12,23 @@
 
 #include <mutex>
 #include <atomic>
+#include <chrono>
 
+class Shader;
+
+// Chunks, generation, storage and edits. Meshing and rendering are the only OpenGL parts, a world
+// created without meshing never touches OpenGL and runs from updateGeneration alone.
 class World
 {
+public:
+	struct ChunkArea
+	{
+		Int3 minChunk; // Inclusive
+		Int3 maxChunk;
+
+		bool operator==(const ChunkArea& other) const { return minChunk == other.minChunk && maxChunk == other.maxChunk; }
+	};
+private:
 	class ChunkPool
 	{
 		std::vector<std::unique_ptr<Chunk>> pool;
@@ -29,19 +46,72 @@ class World
 		void release(std::unique_ptr<Chunk> chunk);
 	};
 
+	// Declared before the chunks, which release their column data on destruction
+	TerrainGenerator generator;
+	ThreadPool& threadPool; // Runs generation stages, may be shared between worlds
+	const bool meshing; // Finished chunks are queued for buildChunkMeshes
+
 	ChunkPool chunkPool;
 	std::unordered_map<Int3, std::unique_ptr<Chunk>, Int3Hasher> chunks;
 	
-	std::mutex blocksBuildMutex;
-	std::unordered_set<Chunk*> blocksBuildChunkContainer;
+	// Generation pipeline. Stage tasks are started from the main thread and lock their whole region,
+	// so tasks never touch the same chunk. Workers only report finished tasks.
+	std::unordered_set<Chunk*> generationChunkContainer; // Chunks that haven't finished all stages
+	bool generationDirty = false; // Chunks were loaded or tasks finished since the last scheduling pass
+	size_t generationTasksInFlight = 0;
+
+	struct GenerationResult
+	{
+		Chunk* chunk; // Center of the finished stage task
+		bool relight = false; // Light stage of a finished chunk, the stage doesn't advance
+		std::vector<PendingBlockWrite> pendingWrites; // Features placed into other chunks
+	};
+	std::mutex generationResultsMutex;
+	std::vector<GenerationResult> generationResults;
+
+	// Feature writes waiting for their target chunk's region to reach the Light stage. The target may not be loaded yet.
+	std::unordered_map<Int3, std::vector<PendingBlockWrite>, Int3Hasher> pendingBlockWrites;
+	size_t pendingBlockWriteCount = 0;
 	
 	std::mutex meshBuildMutex;
 	std::unordered_set<Chunk*> meshBuildChunkContainer;
 
-	Int3 lastChunkLoaderPos;
+	// Persistence. Loaded chunks wait for the store before generating, stored blocks replace the
+	// generated ones after the Features stage, so neighbours still receive the chunk's features.
+	ChunkStore chunkStore;
+	std::unordered_map<Int3, Chunk*, Int3Hasher> storageLoads; // Waiting for the store's answer
+	std::unordered_map<Chunk*, ChunkStore::ChunkData> storedChunkData; // Applied by the chunk's Features task
+
+	// Chunks with unsaved edits when the running snapshot began. A few are handed to the store every update,
+	// an edit or unload hands the chunk over first, so the snapshot gets its state from that moment.
+	static constexpr size_t SNAPSHOT_CHUNKS_PER_UPDATE = 32;
+	std::unordered_set<Int3, Int3Hasher> snapshotChunks;
+	bool snapshotCapturing = false;
+
+	// Edits of chunks inside a running stage task's region wait for it to finish
+	struct BlockEdit
+	{
+		Int3 position; // World block coordinates
+		Block block;
+	};
+	std::vector<BlockEdit> deferredBlockEdits;
+
+	// Every applied edit is journaled, the journal is replayed when the save directory is opened after a crash.
+	// A checkpoint saves the edited chunks and starts a new journal file, older files are deleted once the
+	// store has written those saves.
+	static constexpr std::chrono::seconds JOURNAL_CHECKPOINT_INTERVAL{ 60 };
+	EditJournal editJournal;
+	std::unordered_map<Int3, std::vector<EditJournal::Entry>, Int3Hasher> journalReplayEdits; // Applied once the chunk is generated
+	std::vector<Int3> journalReplayBlocked; // Generated chunks whose replay waits for a running task's region
+	std::chrono::steady_clock::time_point lastJournalCheckpoint;
+	uint64_t journalCheckpointFile = 0; // Older files are discarded once journalCheckpointFlush completes
+	uint64_t journalCheckpointFlush = 0;
+
+	std::vector<ChunkArea> lastLoadAreas;
 	bool firstLoad = true;
+	bool unloadDeferred = false; // Some out of range chunks were locked by stage tasks
 public:
-	World();
+	World(ThreadPool& threadPool, int seed, bool meshing = true);
 	~World();
 
 	World(const World&) = delete;
@@ -50,9 +120,39 @@ public:
 	World& operator=(World&&) = delete;
 
 	void loadChunksAroundPlayer(const Int3& chunkLoaderPos, int renderDistance);
+	void loadChunksAroundPlayers(const std::vector<Int3>& chunkLoaderPositions, int renderDistance);
+	void loadChunkArea(const Int3& minChunk, const Int3& maxChunk);
+	void loadChunkAreas(const std::vector<ChunkArea>& areas); // Chunks outside every area are unloaded
+
+	// Generation and meshing, the OpenGL parts need the main thread's context
 	void update();
 	void render(const Shader& faceShader) const;
 
+	// Generation only, no OpenGL calls. update() calls it too.
+	void updateGeneration();
+	TerrainGenerator& getGenerator() { return generator; }
+	size_t getGenerationTasksInFlight() const { return generationTasksInFlight; }
+	size_t getLoadedChunkCount() const { return chunks.size(); }
+	void waitForGenerationTasks();
+
+	template<typename Func>
+	void forEachChunk(Func func) const;
+
+	// Edited chunks are saved when unloaded, at journal checkpoints and when the world is destroyed, as deltas
+	// against the generator where that is smaller. Unedited chunks are only saved by saveChunkArea. Without a save directory edits are lost.
+	bool openSaveDirectory(const std::string& directory, bool deltaSaves = true);
+	void saveModifiedChunks(); // Queues the saves, doesn't wait for the disk
+	size_t saveChunkArea(const Int3& minChunk, const Int3& maxChunk); // Every fully generated chunk, edited or not. Returns the count.
+	size_t getStorageLoadsPending() const { return storageLoads.size(); }
+
+	// Backup of the save directory and unsaved chunks as of this call, written in the background. False if one is running.
+	bool beginSnapshot(const std::string& directory);
+	bool isSnapshotActive() const { return chunkStore.isSnapshotActive(); }
+
+	// World block coordinates. Edits need a fully generated chunk and relight the chunks around the block.
+	Block getBlock(const Int3& position) const;
+	bool setBlock(const Int3& position, Block block);
+
 	// Debug
 	void rebuildAllChunkMeshes();
 	void debugMethod();
@@ -60,8 +160,31 @@ public:
 	void getChunkMeshesInfo(size_t& totalFaces, size_t& totalFaceCapacity, size_t& potentialMaximumCapacity);
 private:
 	void loadChunk(int chunkX, int chunkY, int chunkZ);
+	void startGeneration(Chunk* chunk);
+	void collectStorageLoads();
+	void saveChunk(Chunk* chunk);
+	void captureSnapshotChunk(Chunk* chunk);
+	void updateSnapshot();
+	bool applyBlockEdit(const BlockEdit& edit);
+	void collectRelightChunks(const Int3& chunkPos, int x, int y, int z, std::vector<Chunk*>& relightChunks) const;
+	void requestRelight(Chunk* chunk);
+	void updateJournal();
+	void checkpointJournal();
+	bool applyReplayedEdits(Chunk* chunk);
 
-	void startBuildingChunkBlocks();
+	void collectGenerationResults();
+	void scheduleGenerationStages();
 	void buildChunkMeshes();
+
+	void recordProfilerCounters();
 };
 
+template<typename Func>
+inline void World::forEachChunk(Func func) const
+{
+	for (const auto& pair : chunks)
+	{
+		func(static_cast<const Chunk&>(*pair.second));
+	}
+}
+
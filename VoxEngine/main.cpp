@@ -3,6 +3,10 @@
 #include "Graphics/Shader.h"
 
 #include <iostream>
+#include <cstdlib>
+#include <ctime>
+#include <chrono>
+#include <thread>
 
 #include "World.h"
 #include "Player.h"
@@ -10,10 +14,70 @@
 #include "UpdateTimer.h"
 #include "Profiler.h"
 
-int main()
+#include "Benchmarks/Benchmark.h"
+#include "Benchmarks/FlythroughBenchmark.h"
+#include "Tools/ReproducibilityCheck.h"
+#include "Tools/Pregenerator.h"
+#include "Tools/HeadlessServer.h"
+#include "Tools/InputRecording.h"
+
+int main(int argc, char** argv)
 {
+    // Benchmarks run without a window
+    if (argc >= 2 && std::string(argv[1]) == "--benchmark")
+    {
+        std::string name = argc >= 3 ? argv[2] : "all";
+        if (!Benchmark::run(name))
+        {
+            std::cerr << "Unknown benchmark: " << name << std::endl;
+            return -1;
+        }
+        return 0;
+    }
+
+    if (argc >= 2 && std::string(argv[1]) == "--flythrough")
+    {
+        return FlythroughBenchmark::runFromArguments(argc - 2, argv + 2);
+    }
+
+    if (argc >= 2 && std::string(argv[1]) == "--reproducibility")
+    {
+        int seed = argc >= 3 ? std::atoi(argv[2]) : 1337;
+        return ReproducibilityCheck::run(seed) ? 0 : 1;
+    }
+
+    if (argc >= 2 && std::string(argv[1]) == "--pregenerate")
+    {
+        return Pregenerator::runFromArguments(argc - 2, argv + 2);
+    }
+
+    if (argc >= 2 && std::string(argv[1]) == "--server")
+    {
+        return HeadlessServer::runFromArguments(argc - 2, argv + 2);
+    }
+
+    // Windowed modes: --record <file> logs every frame's input, --replay <file> [report.json] plays one back
+    std::string recordPath, replayPath, replayReportPath;
+    if (argc >= 3 && std::string(argv[1]) == "--record")
+    {
+        recordPath = argv[2];
+    }
+    if (argc >= 3 && std::string(argv[1]) == "--replay")
+    {
+        replayPath = argv[2];
+        replayReportPath = argc >= 4 ? argv[3] : "";
+    }
+
     try
     {
+        // Replay
+        InputReplay replay;
+        const bool replaying = !replayPath.empty();
+        if (replaying && !replay.open(replayPath))
+        {
+            return -1;
+        }
+
         // Window
         WindowManager wnd({ 1280, 720, "My OpenGL 4.6 Window", true });
 
@@ -39,20 +103,38 @@ int main()
         Player player({ 0.0f, 2.0f, 0.0f }, glm::radians(180.0f), 0.0f);
         player.getCamera().setAspectRatio(wnd.getAspectRatio());
 
-        // World
-        World world;
+        // World. A replay starts from freshly generated terrain and leaves the save and column cache alone.
+        const int seed = replaying ? replay.getSeed() : 1337;
+        World world(ParallelUtils::getGlobalThreadPool(), seed);
+        if (!replaying)
+        {
+            world.getGenerator().openColumnDiskCache("columns.cache", 1 << 15);
+            world.openSaveDirectory("world");
+        }
 
         // Input
-        glm::vec2 previousMousePos;
-        wnd.getMousePos(previousMousePos.x, previousMousePos.y);
+        InputState input = replaying ? replay.getInitialState() : wnd.getInputState();
+        glm::vec2 previousMousePos(input.mouseX, input.mouseY);
         glfwSetInputMode(wnd.getWindow(), GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
+        InputRecorder recorder;
+        if (!recordPath.empty())
+        {
+            recorder.open(recordPath, seed, input);
+        }
+
+        // Profiler
+        Profiler::setThreadName("Main thread");
+        Profiler::setHitchCapture(50.0, 3.0);
+
         // Timers
 		float lastTime = static_cast<float>(glfwGetTime());
+        const double replayStartTime = glfwGetTime();
 		UpdateTimer playerUpdateTimer(20.0f);
 		UpdateTimer worldUpdateTimer(20.0f); worldUpdateTimer.setUpdateToTrue();
 		UpdateTimer profilerUpdateTimer(1.0f / 3.0f);
         UpdateTimer debugUpdateTimer(10.0f);
+        UpdateTimer backupUpdateTimer(1.0f / 3600.0f);
 
         // Main loop
         while (!wnd.shouldClose())
@@ -62,19 +144,44 @@ int main()
             // Poll events
             wnd.pollEvents();
 
-			// Time logic
-			float time = static_cast<float>(glfwGetTime());
-			float deltaTime = time - lastTime;
-			lastTime = time;
+			// Time logic and input, recorded or replayed together so the timers below tick on the same frames
+			float deltaTime;
+            if (replaying)
+            {
+                if (!replay.nextFrame(deltaTime, input))
+                {
+                    break;
+                }
+
+                // Never ahead of the recorded session, so generation gets as much wall time as it had then
+                double ahead = replay.getRecordedTime() - (glfwGetTime() - replayStartTime);
+                if (ahead > 0.0)
+                {
+                    std::this_thread::sleep_for(std::chrono::duration<double>(ahead));
+                }
+            }
+            else
+            {
+                float time = static_cast<float>(glfwGetTime());
+                deltaTime = time - lastTime;
+                lastTime = time;
+
+                input = wnd.getInputState();
+                recorder.recordFrame(deltaTime, input);
+            }
+            auto frameStart = std::chrono::steady_clock::now();
 
 			playerUpdateTimer.addTime(deltaTime);
 			worldUpdateTimer.addTime(deltaTime);
 			profilerUpdateTimer.addTime(deltaTime);
             debugUpdateTimer.addTime(deltaTime);
+            backupUpdateTimer.addTime(deltaTime);
 
             // World
             if (worldUpdateTimer.shouldUpdate())
             {
+                auto worldUpdateStart = std::chrono::steady_clock::now();
+
 				glm::vec3 playerPos = player.getPosition();
                 Int3 playerChunkPos(
                     static_cast<int>(floorf(playerPos.x / CHUNK_SIZE)),
@@ -85,22 +192,45 @@ int main()
 				world.loadChunksAroundPlayer(playerChunkPos, 8);
 				world.update();
 
-                if (wnd.isKeyPressed(GLFW_KEY_P))
+                if (replaying)
+                {
+                    replay.recordWorldUpdateTime(std::chrono::duration<double>(std::chrono::steady_clock::now() - worldUpdateStart).count());
+                }
+
+                if (input.isKeyPressed(InputKey::RebuildMeshes))
                 {
                     world.rebuildAllChunkMeshes();
                     std::cout << "World: All chunks meshes are rebuild." << std::endl;
                 }
 
-                if (wnd.isKeyPressed(GLFW_KEY_O))
+                if (input.isKeyPressed(InputKey::DebugMethod))
                 {
                     world.debugMethod();
                 }
+
+                // Hourly backups, F5 for one now
+                if ((backupUpdateTimer.shouldUpdate() || input.isKeyPressed(InputKey::Backup)) && !world.isSnapshotActive())
+                {
+                    char timestamp[32];
+                    std::time_t now = std::time(nullptr);
+                    std::strftime(timestamp, sizeof(timestamp), "%Y%m%d_%H%M%S", std::localtime(&now));
+                    if (world.beginSnapshot(std::string("backups/") + timestamp))
+                    {
+                        std::cout << "World: Snapshot " << timestamp << " started." << std::endl;
+                    }
+                }
+
+                if (input.isKeyPressed(InputKey::CaptureTimeline) && !Profiler::isCapturing())
+                {
+                    Profiler::requestCapture(60);
+                    std::cout << "Profiler: Capturing timeline for 60 frames." << std::endl;
+                }
             }
 
 			// Player
 			if (playerUpdateTimer.shouldUpdate())
             {
-				player.update(wnd, playerUpdateTimer.getUpdateInterval(), previousMousePos);
+				player.update(input, playerUpdateTimer.getUpdateInterval(), previousMousePos);
             }
 			player.interpolateCameraTransform(playerUpdateTimer.getAccumulatedTimeInPercent());
 
@@ -120,6 +250,11 @@ int main()
             // Swap buffers
             wnd.swapBuffers();
 
+            if (replaying)
+            {
+                replay.recordFrameTime(std::chrono::duration<double>(std::chrono::steady_clock::now() - frameStart).count());
+            }
+
             //Profiler
             Profiler::endFrame();
 
@@ -140,14 +275,27 @@ int main()
             if (profilerUpdateTimer.shouldUpdate())
             {
                 Profiler::printProfileReport();
+                Profiler::printCallTreeReport();
 				Profiler::resetAllProfiles();
             }
         }
+
+        if (replaying)
+        {
+            replay.printReport(world.getLoadedChunkCount());
+            if (!replayReportPath.empty() && !replay.writeReport(replayReportPath, world.getLoadedChunkCount()))
+            {
+                std::cerr << "InputReplay: Failed to write " << replayReportPath << std::endl;
+            }
+        }
     }
     catch (const std::exception& e)
     {
         std::cerr << "Fatal error: " << e.what() << std::endl;
+        Profiler::shutdown();
         return -1;
     }
+
+    Profiler::shutdown();
 	return 0;
 }
\ No newline at end of file